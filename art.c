@@ -0,0 +1,839 @@
+#include <stdlib.h>
+#include <string.h>
+#include "art.h"
+#include "slab.h"
+
+#define ART_IS_LEAF(ptr) (((uintptr_t) (ptr)) & 1)
+#define ART_LEAF(item) ((void *) ((uintptr_t) (item) | 1))
+#define ART_LEAF_ITEM(ptr) ((struct ht_item *) ((uintptr_t) (ptr) & ~(uintptr_t) 1))
+
+struct art_node4 {
+    struct art_node n;
+    unsigned char keys[4];
+    void *children[4];
+};
+
+struct art_node16 {
+    struct art_node n;
+    unsigned char keys[16];
+    void *children[16];
+};
+
+/*
+ * index holds the position in children (plus one, 0 is no child)
+ * of the child for every byte
+ * */
+struct art_node48 {
+    struct art_node n;
+    unsigned char index[256];
+    void *children[48];
+};
+
+struct art_node256 {
+    struct art_node n;
+    void *children[256];
+};
+
+static size_t art_node_size(uint8_t type) {
+    switch (type) {
+        case ART_NODE4:
+            return sizeof(struct art_node4);
+        case ART_NODE16:
+            return sizeof(struct art_node16);
+        case ART_NODE48:
+            return sizeof(struct art_node48);
+        default:
+            return sizeof(struct art_node256);
+    }
+}
+
+static struct art_node *art_node_new(uint8_t type) {
+    struct art_node *node = slab_alloc(art_node_size(type));
+    memset(node, 0, art_node_size(type));
+    node->type = type;
+    return node;
+}
+
+static void art_node_free(struct art_node *node) {
+    slab_free(node, art_node_size(node->type));
+}
+
+static void art_copy_header(struct art_node *dest, struct art_node *src) {
+    dest->count = src->count;
+    dest->prefix_len = src->prefix_len;
+    memcpy(dest->prefix, src->prefix, ART_MAX_PREFIX);
+}
+
+static inline size_t art_min(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+/*
+ * Returns the slot of the child of node for byte c, NULL if there's none
+ * */
+static void **art_find_child(struct art_node *node, unsigned char c) {
+    switch (node->type) {
+        case ART_NODE4: {
+            struct art_node4 *n = (struct art_node4 *) node;
+            for (int i = 0; i < node->count; i++) {
+                if (n->keys[i] == c) {
+                    return &n->children[i];
+                }
+            }
+            return NULL;
+        }
+        case ART_NODE16: {
+            struct art_node16 *n = (struct art_node16 *) node;
+            for (int i = 0; i < node->count; i++) {
+                if (n->keys[i] == c) {
+                    return &n->children[i];
+                }
+            }
+            return NULL;
+        }
+        case ART_NODE48: {
+            struct art_node48 *n = (struct art_node48 *) node;
+            return n->index[c] != 0 ? &n->children[n->index[c] - 1] : NULL;
+        }
+        default: {
+            struct art_node256 *n = (struct art_node256 *) node;
+            return n->children[c] != NULL ? &n->children[c] : NULL;
+        }
+    }
+}
+
+/*
+ * Returns the child of node with the lowest byte above c, NULL if
+ * there's none
+ * */
+static void *art_next_child(struct art_node *node, unsigned char c) {
+    switch (node->type) {
+        case ART_NODE4: {
+            struct art_node4 *n = (struct art_node4 *) node;
+            for (int i = 0; i < node->count; i++) {
+                if (n->keys[i] > c) {
+                    return n->children[i];
+                }
+            }
+            return NULL;
+        }
+        case ART_NODE16: {
+            struct art_node16 *n = (struct art_node16 *) node;
+            for (int i = 0; i < node->count; i++) {
+                if (n->keys[i] > c) {
+                    return n->children[i];
+                }
+            }
+            return NULL;
+        }
+        case ART_NODE48: {
+            struct art_node48 *n = (struct art_node48 *) node;
+            for (int i = c + 1; i < 256; i++) {
+                if (n->index[i] != 0) {
+                    return n->children[n->index[i] - 1];
+                }
+            }
+            return NULL;
+        }
+        default: {
+            struct art_node256 *n = (struct art_node256 *) node;
+            for (int i = c + 1; i < 256; i++) {
+                if (n->children[i] != NULL) {
+                    return n->children[i];
+                }
+            }
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Returns the leftmost item under node
+ * */
+static struct ht_item *art_minimum(void *node) {
+    while (!ART_IS_LEAF(node)) {
+        struct art_node *n = node;
+        switch (n->type) {
+            case ART_NODE4:
+                node = ((struct art_node4 *) n)->children[0];
+                break;
+            case ART_NODE16:
+                node = ((struct art_node16 *) n)->children[0];
+                break;
+            case ART_NODE48: {
+                struct art_node48 *n48 = (struct art_node48 *) n;
+                int c = 0;
+                while (n48->index[c] == 0) {
+                    c++;
+                }
+                node = n48->children[n48->index[c] - 1];
+                break;
+            }
+            default: {
+                struct art_node256 *n256 = (struct art_node256 *) n;
+                int c = 0;
+                while (n256->children[c] == NULL) {
+                    c++;
+                }
+                node = n256->children[c];
+                break;
+            }
+        }
+    }
+    return ART_LEAF_ITEM(node);
+}
+
+/*
+ * Returns how many bytes of the path of node match key from depth,
+ * up to max: the bytes that are not in prefix are read from a leaf
+ * */
+static size_t art_prefix_match(struct art_node *node, const unsigned char *key, size_t depth, size_t max) {
+    size_t len = art_min(node->prefix_len, max), i = 0;
+    size_t stored = art_min(len, ART_MAX_PREFIX);
+    for (; i < stored; i++) {
+        if (node->prefix[i] != key[depth + i]) {
+            return i;
+        }
+    }
+    if (i < len) {
+        const unsigned char *leaf_key = (const unsigned char *) art_minimum(node)->key;
+        for (; i < len; i++) {
+            if (leaf_key[depth + i] != key[depth + i]) {
+                return i;
+            }
+        }
+    }
+    return i;
+}
+
+static void art_add_child(struct art_node *node, void **ref, unsigned char c, void *child);
+
+static void art_add_child4(struct art_node4 *n, void **ref, unsigned char c, void *child) {
+    if (n->n.count < 4) {
+        int i = 0;
+        while (i < n->n.count && n->keys[i] < c) {
+            i++;
+        }
+        memmove(n->keys + i + 1, n->keys + i, n->n.count - i);
+        memmove(n->children + i + 1, n->children + i, sizeof(void *) * (n->n.count - i));
+        n->keys[i] = c;
+        n->children[i] = child;
+        n->n.count++;
+        return;
+    }
+    struct art_node16 *bigger = (struct art_node16 *) art_node_new(ART_NODE16);
+    art_copy_header(&bigger->n, &n->n);
+    memcpy(bigger->keys, n->keys, 4);
+    memcpy(bigger->children, n->children, sizeof(void *) * 4);
+    *ref = bigger;
+    art_node_free(&n->n);
+    art_add_child(&bigger->n, ref, c, child);
+}
+
+static void art_add_child16(struct art_node16 *n, void **ref, unsigned char c, void *child) {
+    if (n->n.count < 16) {
+        int i = 0;
+        while (i < n->n.count && n->keys[i] < c) {
+            i++;
+        }
+        memmove(n->keys + i + 1, n->keys + i, n->n.count - i);
+        memmove(n->children + i + 1, n->children + i, sizeof(void *) * (n->n.count - i));
+        n->keys[i] = c;
+        n->children[i] = child;
+        n->n.count++;
+        return;
+    }
+    struct art_node48 *bigger = (struct art_node48 *) art_node_new(ART_NODE48);
+    art_copy_header(&bigger->n, &n->n);
+    for (int i = 0; i < 16; i++) {
+        bigger->children[i] = n->children[i];
+        bigger->index[n->keys[i]] = (unsigned char) (i + 1);
+    }
+    *ref = bigger;
+    art_node_free(&n->n);
+    art_add_child(&bigger->n, ref, c, child);
+}
+
+static void art_add_child48(struct art_node48 *n, void **ref, unsigned char c, void *child) {
+    if (n->n.count < 48) {
+        int pos = 0;
+        while (n->children[pos] != NULL) {
+            pos++;
+        }
+        n->children[pos] = child;
+        n->index[c] = (unsigned char) (pos + 1);
+        n->n.count++;
+        return;
+    }
+    struct art_node256 *bigger = (struct art_node256 *) art_node_new(ART_NODE256);
+    art_copy_header(&bigger->n, &n->n);
+    for (int i = 0; i < 256; i++) {
+        if (n->index[i] != 0) {
+            bigger->children[i] = n->children[n->index[i] - 1];
+        }
+    }
+    *ref = bigger;
+    art_node_free(&n->n);
+    art_add_child(&bigger->n, ref, c, child);
+}
+
+/*
+ * Adds child for byte c to node, which *ref points to: if node is full
+ * it's replaced by a bigger one
+ * */
+static void art_add_child(struct art_node *node, void **ref, unsigned char c, void *child) {
+    switch (node->type) {
+        case ART_NODE4:
+            art_add_child4((struct art_node4 *) node, ref, c, child);
+            break;
+        case ART_NODE16:
+            art_add_child16((struct art_node16 *) node, ref, c, child);
+            break;
+        case ART_NODE48:
+            art_add_child48((struct art_node48 *) node, ref, c, child);
+            break;
+        default: {
+            struct art_node256 *n = (struct art_node256 *) node;
+            n->children[c] = child;
+            n->n.count++;
+            break;
+        }
+    }
+}
+
+void art_init(struct art *art) {
+    art->root = NULL;
+    art->count = 0;
+}
+
+/*
+ * Returns the item with key, NULL if there's none
+ * */
+struct ht_item *art_get(struct art *art, const char *key) {
+    const unsigned char *k = (const unsigned char *) key;
+    size_t key_len = strlen(key) + 1, depth = 0;
+    void *node = art->root;
+    while (node != NULL) {
+        if (ART_IS_LEAF(node)) {
+            struct ht_item *item = ART_LEAF_ITEM(node);
+            return strcmp(item->key, key) == 0 ? item : NULL;
+        }
+        struct art_node *n = node;
+        if (n->prefix_len > 0) {
+            /*
+             * Only the bytes in prefix are checked, the leaf will tell
+             * about the rest
+             * */
+            size_t stored = art_min(n->prefix_len, ART_MAX_PREFIX);
+            for (size_t i = 0; i < stored; i++) {
+                if (n->prefix[i] != k[depth + i]) {
+                    return NULL;
+                }
+            }
+            depth += n->prefix_len;
+            if (depth >= key_len) {
+                return NULL;
+            }
+        }
+        void **child = art_find_child(n, k[depth]);
+        node = child != NULL ? *child : NULL;
+        depth++;
+    }
+    return NULL;
+}
+
+/*
+ * Returns the item with the lowest key above key (in the order of
+ * strcmp), NULL if there's none: it's the leftmost item of the last
+ * subtree to the right of the path to key
+ * */
+struct ht_item *art_successor(struct art *art, const char *key) {
+    const unsigned char *k = (const unsigned char *) key;
+    size_t depth = 0;
+    void *node = art->root, *next = NULL;
+    while (node != NULL) {
+        if (ART_IS_LEAF(node)) {
+            struct ht_item *item = ART_LEAF_ITEM(node);
+            if (strcmp(item->key, key) > 0) {
+                return item;
+            }
+            break;
+        }
+        struct art_node *n = node;
+        if (n->prefix_len > 0) {
+            size_t match = art_prefix_match(n, k, depth, n->prefix_len);
+            if (match < n->prefix_len) {
+                /*
+                 * The path of n leaves key here: either all of its keys
+                 * are above key or all of them are below
+                 * */
+                unsigned char c = match < ART_MAX_PREFIX ? n->prefix[match]
+                                                         : (unsigned char) art_minimum(n)->key[depth + match];
+                if (c > k[depth + match]) {
+                    return art_minimum(n);
+                }
+                break;
+            }
+            depth += n->prefix_len;
+        }
+        void *right = art_next_child(n, k[depth]);
+        if (right != NULL) {
+            next = right;
+        }
+        void **child = art_find_child(n, k[depth]);
+        node = child != NULL ? *child : NULL;
+        depth++;
+    }
+    return next != NULL ? art_minimum(next) : NULL;
+}
+
+static void art_insert_at(void **ref, struct ht_item *item, const unsigned char *key, size_t depth) {
+    void *node = *ref;
+    if (node == NULL) {
+        *ref = ART_LEAF(item);
+        return;
+    }
+    if (ART_IS_LEAF(node)) {
+        /*
+         * Split the leaf: the new node holds the bytes both keys share
+         * (they can't be the same, so they differ before either ends)
+         * */
+        const unsigned char *other = (const unsigned char *) ART_LEAF_ITEM(node)->key;
+        size_t i = depth;
+        while (other[i] == key[i]) {
+            i++;
+        }
+        struct art_node *split = art_node_new(ART_NODE4);
+        split->prefix_len = (uint32_t) (i - depth);
+        memcpy(split->prefix, key + depth, art_min(split->prefix_len, ART_MAX_PREFIX));
+        *ref = split;
+        art_add_child(split, ref, key[i], ART_LEAF(item));
+        art_add_child(split, ref, other[i], node);
+        return;
+    }
+    struct art_node *n = node;
+    if (n->prefix_len > 0) {
+        size_t match = art_prefix_match(n, key, depth, n->prefix_len);
+        if (match < n->prefix_len) {
+            /*
+             * key leaves the path of n: a new node takes the part they
+             * share, and n keeps what comes after the byte that differs
+             * */
+            struct art_node *split = art_node_new(ART_NODE4);
+            split->prefix_len = (uint32_t) match;
+            memcpy(split->prefix, key + depth, art_min(match, ART_MAX_PREFIX));
+            unsigned char c;
+            if (n->prefix_len <= ART_MAX_PREFIX) {
+                c = n->prefix[match];
+                n->prefix_len -= (uint32_t) (match + 1);
+                memmove(n->prefix, n->prefix + match + 1, art_min(n->prefix_len, ART_MAX_PREFIX));
+            } else {
+                const unsigned char *leaf_key = (const unsigned char *) art_minimum(n)->key;
+                c = leaf_key[depth + match];
+                n->prefix_len -= (uint32_t) (match + 1);
+                memcpy(n->prefix, leaf_key + depth + match + 1, art_min(n->prefix_len, ART_MAX_PREFIX));
+            }
+            *ref = split;
+            art_add_child(split, ref, c, n);
+            art_add_child(split, ref, key[depth + match], ART_LEAF(item));
+            return;
+        }
+        depth += n->prefix_len;
+    }
+    void **child = art_find_child(n, key[depth]);
+    if (child != NULL) {
+        art_insert_at(child, item, key, depth + 1);
+    } else {
+        art_add_child(n, ref, key[depth], ART_LEAF(item));
+    }
+}
+
+/*
+ * Adds item, whose key must not be in art already
+ * */
+void art_insert(struct art *art, struct ht_item *item) {
+    art_insert_at(&art->root, item, (const unsigned char *) item->key, 0);
+    art->count++;
+}
+
+static void art_remove_child4(struct art_node4 *n, void **ref, void **slot) {
+    int pos = (int) (slot - n->children);
+    memmove(n->keys + pos, n->keys + pos + 1, n->n.count - 1 - pos);
+    memmove(n->children + pos, n->children + pos + 1, sizeof(void *) * (n->n.count - 1 - pos));
+    n->n.count--;
+    if (n->n.count == 1) {
+        /*
+         * Merge the node into its only child, whose path gets
+         * the one of the node and the byte of the child in front
+         * */
+        void *child = n->children[0];
+        if (!ART_IS_LEAF(child)) {
+            struct art_node *c = child;
+            unsigned char prefix[ART_MAX_PREFIX];
+            size_t len = art_min(n->n.prefix_len, ART_MAX_PREFIX);
+            memcpy(prefix, n->n.prefix, len);
+            if (len < ART_MAX_PREFIX) {
+                prefix[len++] = n->keys[0];
+            }
+            if (len < ART_MAX_PREFIX) {
+                size_t sub = art_min(c->prefix_len, ART_MAX_PREFIX - len);
+                memcpy(prefix + len, c->prefix, sub);
+                len += sub;
+            }
+            memcpy(c->prefix, prefix, len);
+            c->prefix_len += n->n.prefix_len + 1;
+        }
+        *ref = child;
+        art_node_free(&n->n);
+    }
+}
+
+static void art_remove_child16(struct art_node16 *n, void **ref, void **slot) {
+    int pos = (int) (slot - n->children);
+    memmove(n->keys + pos, n->keys + pos + 1, n->n.count - 1 - pos);
+    memmove(n->children + pos, n->children + pos + 1, sizeof(void *) * (n->n.count - 1 - pos));
+    n->n.count--;
+    if (n->n.count == 3) {
+        struct art_node4 *smaller = (struct art_node4 *) art_node_new(ART_NODE4);
+        art_copy_header(&smaller->n, &n->n);
+        memcpy(smaller->keys, n->keys, 3);
+        memcpy(smaller->children, n->children, sizeof(void *) * 3);
+        *ref = smaller;
+        art_node_free(&n->n);
+    }
+}
+
+static void art_remove_child48(struct art_node48 *n, void **ref, unsigned char c) {
+    n->children[n->index[c] - 1] = NULL;
+    n->index[c] = 0;
+    n->n.count--;
+    if (n->n.count == 12) {
+        struct art_node16 *smaller = (struct art_node16 *) art_node_new(ART_NODE16);
+        art_copy_header(&smaller->n, &n->n);
+        int pos = 0;
+        for (int i = 0; i < 256; i++) {
+            if (n->index[i] != 0) {
+                smaller->keys[pos] = (unsigned char) i;
+                smaller->children[pos++] = n->children[n->index[i] - 1];
+            }
+        }
+        *ref = smaller;
+        art_node_free(&n->n);
+    }
+}
+
+static void art_remove_child256(struct art_node256 *n, void **ref, unsigned char c) {
+    n->children[c] = NULL;
+    n->n.count--;
+    if (n->n.count == 37) {
+        struct art_node48 *smaller = (struct art_node48 *) art_node_new(ART_NODE48);
+        art_copy_header(&smaller->n, &n->n);
+        int pos = 0;
+        for (int i = 0; i < 256; i++) {
+            if (n->children[i] != NULL) {
+                smaller->children[pos] = n->children[i];
+                smaller->index[i] = (unsigned char) ++pos;
+            }
+        }
+        *ref = smaller;
+        art_node_free(&n->n);
+    }
+}
+
+/*
+ * Removes the child for byte c, in slot, from node, which *ref points
+ * to: a node left with few enough children is replaced by a smaller one
+ * (a node4 left with one child by the child itself)
+ * */
+static void art_remove_child(struct art_node *node, void **ref, unsigned char c, void **slot) {
+    switch (node->type) {
+        case ART_NODE4:
+            art_remove_child4((struct art_node4 *) node, ref, slot);
+            break;
+        case ART_NODE16:
+            art_remove_child16((struct art_node16 *) node, ref, slot);
+            break;
+        case ART_NODE48:
+            art_remove_child48((struct art_node48 *) node, ref, c);
+            break;
+        default:
+            art_remove_child256((struct art_node256 *) node, ref, c);
+            break;
+    }
+}
+
+/*
+ * Removes the item with key and returns it, NULL if there's none
+ * */
+struct ht_item *art_delete(struct art *art, const char *key) {
+    const unsigned char *k = (const unsigned char *) key;
+    size_t key_len = strlen(key) + 1, depth = 0;
+    void **ref = &art->root;
+    while (*ref != NULL) {
+        if (ART_IS_LEAF(*ref)) {
+            /*
+             * Only the root can be a leaf here
+             * */
+            struct ht_item *item = ART_LEAF_ITEM(*ref);
+            if (strcmp(item->key, key) != 0) {
+                return NULL;
+            }
+            *ref = NULL;
+            art->count--;
+            return item;
+        }
+        struct art_node *n = *ref;
+        if (n->prefix_len > 0) {
+            if (art_prefix_match(n, k, depth, ART_MAX_PREFIX) < art_min(n->prefix_len, ART_MAX_PREFIX)) {
+                return NULL;
+            }
+            depth += n->prefix_len;
+            if (depth >= key_len) {
+                return NULL;
+            }
+        }
+        void **child = art_find_child(n, k[depth]);
+        if (child == NULL) {
+            return NULL;
+        }
+        if (ART_IS_LEAF(*child)) {
+            struct ht_item *item = ART_LEAF_ITEM(*child);
+            if (strcmp(item->key, key) != 0) {
+                return NULL;
+            }
+            art_remove_child(n, ref, k[depth], child);
+            art->count--;
+            return item;
+        }
+        ref = child;
+        depth++;
+    }
+    return NULL;
+}
+
+/*
+ * Calls fn on every item under node, in order
+ * */
+static void art_each(void *node, void (*fn)(struct ht_item *item, void *data), void *data) {
+    if (ART_IS_LEAF(node)) {
+        fn(ART_LEAF_ITEM(node), data);
+        return;
+    }
+    struct art_node *n = node;
+    switch (n->type) {
+        case ART_NODE4: {
+            struct art_node4 *n4 = (struct art_node4 *) n;
+            for (int i = 0; i < n->count; i++) {
+                art_each(n4->children[i], fn, data);
+            }
+            break;
+        }
+        case ART_NODE16: {
+            struct art_node16 *n16 = (struct art_node16 *) n;
+            for (int i = 0; i < n->count; i++) {
+                art_each(n16->children[i], fn, data);
+            }
+            break;
+        }
+        case ART_NODE48: {
+            struct art_node48 *n48 = (struct art_node48 *) n;
+            for (int c = 0; c < 256; c++) {
+                if (n48->index[c] != 0) {
+                    art_each(n48->children[n48->index[c] - 1], fn, data);
+                }
+            }
+            break;
+        }
+        default: {
+            struct art_node256 *n256 = (struct art_node256 *) n;
+            for (int c = 0; c < 256; c++) {
+                if (n256->children[c] != NULL) {
+                    art_each(n256->children[c], fn, data);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Calls fn on every item whose key starts with prefix, in ascending
+ * order of key (the one of strcmp), without sorting anything: the
+ * subtree holding them is found and walked in order
+ * */
+void art_prefix_each(struct art *art, const char *prefix, void (*fn)(struct ht_item *item, void *data), void *data) {
+    const unsigned char *p = (const unsigned char *) prefix;
+    size_t prefix_len = strlen(prefix), depth = 0;
+    void *node = art->root;
+    while (node != NULL) {
+        if (ART_IS_LEAF(node)) {
+            if (strncmp(ART_LEAF_ITEM(node)->key, prefix, prefix_len) == 0) {
+                fn(ART_LEAF_ITEM(node), data);
+            }
+            return;
+        }
+        if (depth == prefix_len) {
+            art_each(node, fn, data);
+            return;
+        }
+        struct art_node *n = node;
+        if (n->prefix_len > 0) {
+            size_t left = prefix_len - depth;
+            size_t match = art_prefix_match(n, p, depth, left);
+            if (match == left) {
+                /*
+                 * prefix ends within the path of n
+                 * */
+                art_each(node, fn, data);
+                return;
+            }
+            if (match < n->prefix_len) {
+                return;
+            }
+            depth += n->prefix_len;
+        }
+        void **child = art_find_child(n, p[depth]);
+        node = child != NULL ? *child : NULL;
+        depth++;
+    }
+}
+
+/*
+ * Returns the child slots of node, setting count to how many of them
+ * can be in use: the first count of a node4 or a node16, all of them
+ * (the empty ones are NULL) otherwise
+ * */
+static void **art_child_slots(struct art_node *node, int *count) {
+    switch (node->type) {
+        case ART_NODE4:
+            *count = node->count;
+            return ((struct art_node4 *) node)->children;
+        case ART_NODE16:
+            *count = node->count;
+            return ((struct art_node16 *) node)->children;
+        case ART_NODE48:
+            *count = 48;
+            return ((struct art_node48 *) node)->children;
+        default:
+            *count = 256;
+            return ((struct art_node256 *) node)->children;
+    }
+}
+
+static uint64_t art_write_node(void *node, uint64_t (*put)(const void *block, size_t len, void *data),
+                               uint64_t (*leaf_offset)(struct ht_item *item, void *data), void *data) {
+    if (ART_IS_LEAF(node)) {
+        return leaf_offset(ART_LEAF_ITEM(node), data) | 1;
+    }
+    struct art_node *n = node;
+    union {
+        struct art_node256 n256;
+        struct art_node48 n48;
+    } copy;
+    memcpy(&copy, n, art_node_size(n->type));
+    int count;
+    void **slots = art_child_slots(n, &count);
+    void **copy_slots = art_child_slots((struct art_node *) &copy, &count);
+    for (int i = 0; i < count; i++) {
+        if (slots[i] != NULL) {
+            copy_slots[i] = (void *) (uintptr_t) art_write_node(slots[i], put, leaf_offset, data);
+        }
+    }
+    /*
+     * The slots of a node4 or a node16 past count may still hold
+     * children it lost
+     * */
+    if (n->type == ART_NODE4 || n->type == ART_NODE16) {
+        int capacity = n->type == ART_NODE4 ? 4 : 16;
+        memset(copy_slots + count, 0, sizeof(void *) * (capacity - count));
+    }
+    return put(&copy, art_node_size(n->type), data);
+}
+
+/*
+ * Writes the nodes of art with put, which writes a block and returns
+ * its offset, children before their parents: in the written nodes
+ * children are offsets rather than pointers, and leaves are the
+ * offsets leaf_offset gives for their items (with the lowest bit set,
+ * like pointers to them). Returns the offset of the root, 0 if art
+ * is empty
+ * */
+uint64_t art_write(struct art *art, uint64_t (*put)(const void *block, size_t len, void *data),
+                   uint64_t (*leaf_offset)(struct ht_item *item, void *data), void *data) {
+    if (art->root == NULL) {
+        return 0;
+    }
+    return art_write_node(art->root, put, leaf_offset, data);
+}
+
+static void *art_relocate_node(uint64_t offset, void *(*at)(uint64_t offset, size_t len, void *data), void *data) {
+    if (offset & 1) {
+        return ART_LEAF(at(offset & ~(uint64_t) 1, sizeof(struct ht_item), data));
+    }
+    struct art_node *n = at(offset, sizeof(struct art_node), data);
+    n = at(offset, art_node_size(n->type), data);
+    int count;
+    void **slots = art_child_slots(n, &count);
+    for (int i = 0; i < count; i++) {
+        if (slots[i] != NULL) {
+            slots[i] = art_relocate_node((uint64_t) (uintptr_t) slots[i], at, data);
+        }
+    }
+    return n;
+}
+
+/*
+ * Turns a tree written by art_write, whose root is the offset held in
+ * art->root, back into pointers: at returns the address of the len
+ * bytes at an offset (the nodes are changed right there)
+ * */
+void art_relocate(struct art *art, void *(*at)(uint64_t offset, size_t len, void *data), void *data) {
+    if (art->root != NULL) {
+        art->root = art_relocate_node((uint64_t) (uintptr_t) art->root, at, data);
+    }
+}
+
+static void art_node_destroy(void *node) {
+    if (ART_IS_LEAF(node)) {
+        return;
+    }
+    struct art_node *n = node;
+    switch (n->type) {
+        case ART_NODE4:
+            for (int i = 0; i < n->count; i++) {
+                art_node_destroy(((struct art_node4 *) n)->children[i]);
+            }
+            break;
+        case ART_NODE16:
+            for (int i = 0; i < n->count; i++) {
+                art_node_destroy(((struct art_node16 *) n)->children[i]);
+            }
+            break;
+        case ART_NODE48:
+            for (int i = 0; i < 48; i++) {
+                if (((struct art_node48 *) n)->children[i] != NULL) {
+                    art_node_destroy(((struct art_node48 *) n)->children[i]);
+                }
+            }
+            break;
+        default:
+            for (int i = 0; i < 256; i++) {
+                if (((struct art_node256 *) n)->children[i] != NULL) {
+                    art_node_destroy(((struct art_node256 *) n)->children[i]);
+                }
+            }
+            break;
+    }
+    art_node_free(n);
+}
+
+/*
+ * Frees the nodes of art, not the items
+ * */
+void art_destroy(struct art *art) {
+    if (art->root != NULL) {
+        art_node_destroy(art->root);
+    }
+    art->root = NULL;
+    art->count = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef PROVAFINALEAPI_ART_H
+#define PROVAFINALEAPI_ART_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hash_table.h"
+
+#define ART_NODE4 0
+#define ART_NODE16 1
+#define ART_NODE48 2
+#define ART_NODE256 3
+
+/*
+ * Bytes of the compressed path kept in every node: longer paths
+ * are skipped while looking keys up and checked at the leaf
+ * */
+#define ART_MAX_PREFIX 8
+
+/*
+ * Adaptive radix tree: an ordered index over the items of a hash
+ * table, keyed by their keys (terminator included, so that no key is
+ * the prefix of another one and shorter keys come first).
+ * The leaves are the items themselves, with the lowest bit of the
+ * pointer set, so keys aren't copied: an item has to stay in the tree
+ * only while it's in its table.
+ * Inner nodes have room for 4, 16, 48 or 256 children and move to the
+ * next size up or down as they fill up or empty. prefix_len is the
+ * length of the path compressed in a node, whose first ART_MAX_PREFIX
+ * bytes are in prefix
+ * */
+struct art_node {
+    uint8_t type;
+    uint16_t count;
+    uint32_t prefix_len;
+    unsigned char prefix[ART_MAX_PREFIX];
+};
+
+struct art {
+    void *root;
+    size_t count;
+};
+
+void art_init(struct art *art);
+
+struct ht_item *art_get(struct art *art, const char *key);
+
+struct ht_item *art_successor(struct art *art, const char *key);
+
+void art_insert(struct art *art, struct ht_item *item);
+
+struct ht_item *art_delete(struct art *art, const char *key);
+
+void art_prefix_each(struct art *art, const char *prefix, void (*fn)(struct ht_item *item, void *data), void *data);
+
+uint64_t art_write(struct art *art, uint64_t (*put)(const void *block, size_t len, void *data),
+                   uint64_t (*leaf_offset)(struct ht_item *item, void *data), void *data);
+
+void art_relocate(struct art *art, void *(*at)(uint64_t offset, size_t len, void *data), void *data);
+
+void art_destroy(struct art *art);
+
+#endif //PROVAFINALEAPI_ART_H
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binary_protocol.h"
+
+static int bin_n_names(int action) {
+    if (action == CMD_ADD_ENT || action == CMD_DEL_ENT) {
+        return 1;
+    } else if (action == CMD_ADD_REL || action == CMD_DEL_REL) {
+        return 3;
+    }
+    return 0;
+}
+
+static void bin_write_record_header(FILE *out, int op, size_t payload_len) {
+    uint8_t code = (uint8_t) op;
+    uint16_t len = (uint16_t) payload_len;
+    fwrite(&code, sizeof(uint8_t), 1, out);
+    fwrite(&len, sizeof(uint16_t), 1, out);
+}
+
+void bin_write_header(FILE *out) {
+    uint32_t version = BIN_VERSION;
+    fwrite(BIN_MAGIC, sizeof(char), 4, out);
+    fwrite(&version, sizeof(uint32_t), 1, out);
+}
+
+void bin_write_declare(FILE *out, uint32_t id, const char *name) {
+    size_t len = strlen(name);
+    bin_write_record_header(out, BIN_OP_DECLARE, sizeof(uint32_t) + len);
+    fwrite(&id, sizeof(uint32_t), 1, out);
+    fwrite(name, sizeof(char), len, out);
+}
+
+void bin_write_command(FILE *out, int action, const uint32_t *ids, int n_ids) {
+    bin_write_record_header(out, action, sizeof(uint32_t) * n_ids);
+    fwrite(ids, sizeof(uint32_t), n_ids, out);
+}
+
+void bin_write_inline_command(FILE *out, int action, char **names, int n_names) {
+    size_t payload_len = 0;
+    for (int i = 0; i < n_names; i++) {
+        payload_len += sizeof(uint16_t) + strlen(names[i]);
+    }
+    bin_write_record_header(out, action | BIN_INLINE_NAMES, payload_len);
+    for (int i = 0; i < n_names; i++) {
+        uint16_t len = (uint16_t) strlen(names[i]);
+        fwrite(&len, sizeof(uint16_t), 1, out);
+        fwrite(names[i], sizeof(char), len, out);
+    }
+}
+
+void bin_write_end(FILE *out) {
+    bin_write_record_header(out, BIN_OP_END, 0);
+}
+
+int bin_read_header(FILE *in) {
+    int c = getc(in);
+    /*
+     * No text command starts with the first character of BIN_MAGIC,
+     * so one character of lookahead is enough to tell them apart
+     * */
+    if (c != BIN_MAGIC[0]) {
+        if (c != EOF) {
+            ungetc(c, in);
+        }
+        return 0;
+    }
+    char magic[3];
+    uint32_t version;
+    if (fread(magic, sizeof(char), 3, in) != 3 || memcmp(magic, BIN_MAGIC + 1, 3) != 0 ||
+        fread(&version, sizeof(uint32_t), 1, in) != 1 || version != BIN_VERSION) {
+        return -1;
+    }
+    return 1;
+}
+
+/*
+ * Names declared so far, indexed by id: ids from 0 to count - 1
+ * are declared
+ * */
+struct bin_names {
+    char **names;
+    size_t count;
+    size_t size;
+};
+
+/*
+ * Returns 0 if id is neither declared nor the next one
+ * */
+static int bin_names_set(struct bin_names *names, uint32_t id, const char *name, size_t len) {
+    if (id > names->count) {
+        return 0;
+    }
+    if (id >= names->size) {
+        size_t new_size = names->size;
+        while (id >= new_size) {
+            new_size *= 2;
+        }
+        names->names = realloc(names->names, sizeof(char *) * new_size);
+        if (names->names == NULL) {
+            exit(666);
+        }
+        memset(names->names + names->size, 0, sizeof(char *) * (new_size - names->size));
+        names->size = new_size;
+    }
+    free(names->names[id]);
+    names->names[id] = malloc(len + 1);
+    if (names->names[id] == NULL) {
+        exit(666);
+    }
+    memcpy(names->names[id], name, len);
+    names->names[id][len] = '\0';
+    if (id == names->count) {
+        names->count++;
+    }
+    return 1;
+}
+
+/*
+ * Points params to the names of payload, copying inline
+ * names to buffers. Returns 0 if payload is malformed
+ * */
+static int bin_decode_names(struct bin_names *names, int inline_names, const char *payload, size_t len,
+                            int n_names, char **params, char buffers[][BIN_MAX_NAME_LENGTH]) {
+    size_t pos = 0;
+    for (int i = 0; i < n_names; i++) {
+        if (inline_names) {
+            uint16_t name_len;
+            if (pos + sizeof(uint16_t) > len) {
+                return 0;
+            }
+            memcpy(&name_len, payload + pos, sizeof(uint16_t));
+            pos += sizeof(uint16_t);
+            if (pos + name_len > len || name_len >= BIN_MAX_NAME_LENGTH) {
+                return 0;
+            }
+            memcpy(buffers[i], payload + pos, name_len);
+            buffers[i][name_len] = '\0';
+            pos += name_len;
+            params[i] = buffers[i];
+        } else {
+            uint32_t id;
+            if (pos + sizeof(uint32_t) > len) {
+                return 0;
+            }
+            memcpy(&id, payload + pos, sizeof(uint32_t));
+            pos += sizeof(uint32_t);
+            if (id >= names->size || names->names[id] == NULL) {
+                return 0;
+            }
+            params[i] = names->names[id];
+        }
+    }
+    return pos == len;
+}
+
+int bin_run(struct engine *engine, FILE *in, FILE *out) {
+    struct bin_names names;
+    char buffers[3][BIN_MAX_NAME_LENGTH];
+    char *payload = malloc(UINT16_MAX);
+    struct command command;
+    int ret = 0;
+    names.count = 0;
+    names.size = INITIAL_BIN_NAMES_SIZE;
+    names.names = calloc(names.size, sizeof(char *));
+    if (names.names == NULL || payload == NULL) {
+        exit(666);
+    }
+
+    uint8_t op;
+    uint16_t len;
+    while (fread(&op, sizeof(uint8_t), 1, in) == 1) {
+        if (fread(&len, sizeof(uint16_t), 1, in) != 1 || fread(payload, sizeof(char), len, in) != len) {
+            ret = -1;
+            break;
+        }
+        if (op == BIN_OP_END) {
+            break;
+        } else if (op == BIN_OP_DECLARE) {
+            uint32_t id;
+            if (len < sizeof(uint32_t) || len - sizeof(uint32_t) >= BIN_MAX_NAME_LENGTH) {
+                ret = -1;
+                break;
+            }
+            memcpy(&id, payload, sizeof(uint32_t));
+            if (!bin_names_set(&names, id, payload + sizeof(uint32_t), len - sizeof(uint32_t))) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+        command.action = op & ~BIN_INLINE_NAMES;
+        memset(command.params, 0, sizeof(command.params));
+        if (command.action < CMD_ADD_ENT || command.action > CMD_REPORT ||
+            !bin_decode_names(&names, op & BIN_INLINE_NAMES, payload, len, bin_n_names(command.action),
+                              command.params, buffers)) {
+            ret = -1;
+            break;
+        }
+        run_command(engine, &command, out);
+    }
+
+    for (size_t i = 0; i < names.size; i++) {
+        free(names.names[i]);
+    }
+    free(names.names);
+    free(payload);
+    return ret;
+}
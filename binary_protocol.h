@@ -0,0 +1,58 @@
+#ifndef PROVAFINALEAPI_BINARY_PROTOCOL_H
+#define PROVAFINALEAPI_BINARY_PROTOCOL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "engine.h"
+
+/*
+ * Binary command stream: BIN_MAGIC and BIN_VERSION (uint32_t), then
+ * records made of an operation code (uint8_t), the length of the
+ * payload (uint16_t) and the payload. All integers are native.
+ *
+ * BIN_OP_DECLARE binds a name to an id: the payload is the id
+ * (uint32_t) followed by the characters of the name. Ids are given
+ * out in order starting from 0: a declaration either rebinds an id
+ * already declared or declares the next one, anything else makes
+ * the stream malformed.
+ * CMD_* operations refer to their names by id: the payload is one
+ * uint32_t per name, in the same order as struct command params.
+ * CMD_* | BIN_INLINE_NAMES carries the names themselves instead:
+ * the payload is a uint16_t length and the characters of each name.
+ * BIN_OP_END ends the stream, like "end" in text streams.
+ * */
+#define BIN_MAGIC "PFBC"
+#define BIN_VERSION 1
+
+#define BIN_OP_DECLARE 16
+#define BIN_OP_END 17
+#define BIN_INLINE_NAMES 128
+
+#define BIN_MAX_NAME_LENGTH 256
+#define INITIAL_BIN_NAMES_SIZE 1024
+
+void bin_write_header(FILE *out);
+
+void bin_write_declare(FILE *out, uint32_t id, const char *name);
+
+void bin_write_command(FILE *out, int action, const uint32_t *ids, int n_ids);
+
+void bin_write_inline_command(FILE *out, int action, char **names, int n_names);
+
+void bin_write_end(FILE *out);
+
+/*
+ * Returns 1 if in starts with a binary header (which is consumed),
+ * 0 if it doesn't (nothing is consumed) and -1 if it's a binary
+ * header of an unknown version
+ * */
+int bin_read_header(FILE *in);
+
+/*
+ * Runs every command of the binary stream in on engine, writing
+ * reports to out. Returns 0 at BIN_OP_END or end of file, -1 if the
+ * stream is malformed
+ * */
+int bin_run(struct engine *engine, FILE *in, FILE *out);
+
+#endif //PROVAFINALEAPI_BINARY_PROTOCOL_H
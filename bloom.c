@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bloom.h"
+#include "slab.h"
+
+static const uint32_t bloom_salts[BLOOM_BLOCK_WORDS] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+static inline uint64_t bloom_mix(unsigned long long int hash) {
+    return (uint64_t) hash * UINT64_C(0x9e3779b97f4a7c15);
+}
+
+static inline uint64_t *bloom_block(struct bloom *bloom, uint64_t mix) {
+    return bloom->blocks + ((mix >> 32) & (bloom->block_count - 1)) * BLOOM_BLOCK_WORDS;
+}
+
+/*
+ * Sizes the filter for capacity keys
+ * */
+void bloom_init(struct bloom *bloom, size_t capacity) {
+    size_t bits = capacity * BLOOM_BITS_PER_KEY;
+    bloom->block_count = 1;
+    while (bloom->block_count * BLOOM_BLOCK_WORDS * 64 < bits) {
+        bloom->block_count *= 2;
+    }
+    /*
+     * Blocks are aligned to cache lines, so reading one is a single miss
+     * */
+    size_t size = bloom->block_count * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    bloom->blocks = aligned_alloc(BLOOM_BLOCK_WORDS * sizeof(uint64_t), size);
+    if (bloom->blocks == NULL) {
+        exit(666);
+    }
+    memset(bloom->blocks, 0, size);
+    bloom->count = 0;
+    bloom->capacity = capacity;
+    bloom->lookups = 0;
+    bloom->misses = 0;
+    bloom->active = 1;
+}
+
+void bloom_add(struct bloom *bloom, unsigned long long int hash) {
+    uint64_t mix = bloom_mix(hash);
+    uint64_t *block = bloom_block(bloom, mix);
+    uint32_t low = (uint32_t) mix;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        block[i] |= UINT64_C(1) << ((low * bloom_salts[i]) >> 26);
+    }
+    bloom->count++;
+}
+
+/*
+ * Returns 0 if the key with hash was never added, 1 if it may have been.
+ * Not inline on purpose: inlined in add_rel it made the path of
+ * monitored entities slower
+ * */
+int bloom_may_contain(struct bloom *bloom, unsigned long long int hash) {
+    uint64_t mix = bloom_mix(hash);
+    uint64_t *block = bloom_block(bloom, mix);
+    uint32_t low = (uint32_t) mix;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+        if (!(block[i] & (UINT64_C(1) << ((low * bloom_salts[i]) >> 26)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Empties the filter, sizing it for capacity keys
+ * */
+void bloom_reset(struct bloom *bloom, size_t capacity) {
+    slab_heap_free(bloom->blocks);
+    bloom_init(bloom, capacity);
+}
+
+void bloom_destroy(struct bloom *bloom) {
+    slab_heap_free(bloom->blocks);
+}
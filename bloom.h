@@ -0,0 +1,75 @@
+#ifndef PROVAFINALEAPI_BLOOM_H
+#define PROVAFINALEAPI_BLOOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bits of filter per key it's sized for, and number of keys it's
+ * sized for at least
+ * */
+#define BLOOM_BITS_PER_KEY 12
+#define INITIAL_BLOOM_CAPACITY 65536
+
+#define BLOOM_BLOCK_WORDS 8
+
+/*
+ * The filter is only looked at during a window of BLOOM_WINDOW lookups
+ * if at least one in BLOOM_MIN_MISS_RATIO of the previous window missed
+ * */
+#define BLOOM_WINDOW 4096
+#define BLOOM_MIN_MISS_RATIO 8
+
+/*
+ * Split block Bloom filter over key hashes: a key only touches one block
+ * (a cache line, picked by the high half of its mixed hash) and sets
+ * one bit in every word of it, picked by the low half times a different
+ * odd constant for each word. Looking a key up is then a single cache
+ * miss at most and a handful of multiplications.
+ * Keys can't be removed: count is the number of keys added since the
+ * filter was last reset, removed ones included, and once it reaches
+ * capacity the false positive rate is no longer the one the filter was
+ * sized for, so it should be reset and filled again.
+ * lookups and misses count the current window, active tells if the
+ * filter is worth looking at (see bloom_record)
+ * */
+struct bloom {
+    uint64_t *blocks;
+    size_t block_count;
+    size_t count;
+    size_t capacity;
+    uint32_t lookups;
+    uint32_t misses;
+    int active;
+};
+
+/*
+ * Counts a lookup of a key (behind the filter or not) and whether it
+ * was found: a filter checked before keys that are mostly there is
+ * just one more cache miss, so it's only used while enough of them
+ * aren't
+ * */
+static inline void bloom_record(struct bloom *bloom, int found) {
+    bloom->misses += !found;
+    if (++bloom->lookups == BLOOM_WINDOW) {
+        bloom->active = bloom->misses * BLOOM_MIN_MISS_RATIO >= BLOOM_WINDOW;
+        bloom->lookups = 0;
+        bloom->misses = 0;
+    }
+}
+
+void bloom_init(struct bloom *bloom, size_t capacity);
+
+void bloom_add(struct bloom *bloom, unsigned long long int hash);
+
+int bloom_may_contain(struct bloom *bloom, unsigned long long int hash);
+
+void bloom_reset(struct bloom *bloom, size_t capacity);
+
+static inline int bloom_full(struct bloom *bloom) {
+    return bloom->count >= bloom->capacity;
+}
+
+void bloom_destroy(struct bloom *bloom);
+
+#endif //PROVAFINALEAPI_BLOOM_H
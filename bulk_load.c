@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bulk_load.h"
+#include "str_sort.h"
+
+/*
+ * Reads the whole file at path into a '\0' terminated buffer
+ * */
+static char *bulk_read_file(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        return NULL;
+    }
+    long size = -1;
+    if (fseek(in, 0, SEEK_END) == 0) {
+        size = ftell(in);
+    }
+    if (size < 0 || fseek(in, 0, SEEK_SET) != 0) {
+        fclose(in);
+        return NULL;
+    }
+    char *buf = malloc((size_t) size + 1);
+    if (buf == NULL) {
+        exit(666);
+    }
+    size_t len = fread(buf, sizeof(char), (size_t) size, in);
+    buf[len] = '\0';
+    fclose(in);
+    return buf;
+}
+
+/*
+ * Splits the line starting at *pos into names, in place: like in
+ * commands, names are separated by spaces and quotes are dropped.
+ * Returns the number of names (only the first max are stored) and
+ * moves *pos to the next line
+ * */
+static int bulk_next_line(char **pos, char **names, int max) {
+    char *src = *pos, *dst = *pos;
+    int n = 0, in_name = 0;
+    while (*src != '\0' && *src != '\n') {
+        char c = *src++;
+        if (c == '\"' || c == '\r') {
+            continue;
+        }
+        if (c == ' ' || c == '\t') {
+            if (in_name) {
+                *dst++ = '\0';
+                in_name = 0;
+            }
+            continue;
+        }
+        if (!in_name) {
+            if (n < max) {
+                names[n] = dst;
+            }
+            n++;
+            in_name = 1;
+        }
+        *dst++ = c;
+    }
+    int newline = *src == '\n';
+    if (in_name) {
+        *dst = '\0';
+    }
+    *pos = newline ? src + 1 : src;
+    return n;
+}
+
+/*
+ * Orders edges by relationship, destination and origin
+ * */
+static int compare_bulk_edges(const void *a, const void *b) {
+    const struct bulk_edge *edge_a = a, *edge_b = b;
+    if (edge_a->rel != edge_b->rel) {
+        return edge_a->rel < edge_b->rel ? -1 : 1;
+    }
+    if (edge_a->dest != edge_b->dest) {
+        return edge_a->dest < edge_b->dest ? -1 : 1;
+    }
+    if (edge_a->origin != edge_b->origin) {
+        return edge_a->origin < edge_b->origin ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * Returns the bytes names take up in a str_arr heap
+ * */
+static size_t bulk_names_size(char **names, size_t count) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(names[i]) + 1;
+    }
+    return size;
+}
+
+/*
+ * Builds the (empty) state from an entity list, one name per line,
+ * and an edge list, one "origin destination relationship" per line.
+ * Both are sorted and deduplicated first, edges between entities that
+ * are not in the list are dropped, and then every table is created
+ * with its final size and filled in a single pass, report caches
+ * included.
+ * Returns 0 on success, -1 if a file could not be read, -2 if the
+ * engine already holds some state (which would be thrown away)
+ * */
+int bulk_load(struct engine *engine, const char *ent_path, const char *edge_path) {
+    if (engine->mon_ent_list->next_free > 0 || engine->mon_rel_list->next_free > 0) {
+        return -2;
+    }
+    char *ent_buf = bulk_read_file(ent_path);
+    if (ent_buf == NULL) {
+        return -1;
+    }
+    char *edge_buf = bulk_read_file(edge_path);
+    if (edge_buf == NULL) {
+        free(ent_buf);
+        return -1;
+    }
+    char *names[3];
+    char *pos;
+
+    /*
+     * Entities: once sorted they're added in order, so that each one
+     * goes at the end of ent_order, where ranks are cheapest to give
+     * out
+     * */
+    size_t ent_count = 0, ents_size = INITIAL_BULK_EDGES_SIZE;
+    char **ents = malloc(sizeof(char *) * ents_size);
+    if (ents == NULL) {
+        exit(666);
+    }
+    pos = ent_buf;
+    while (*pos != '\0') {
+        if (bulk_next_line(&pos, names, 1) != 1) {
+            continue;
+        }
+        if (ent_count == ents_size) {
+            ents_size *= 2;
+            ents = realloc(ents, sizeof(char *) * ents_size);
+            if (ents == NULL) {
+                exit(666);
+            }
+        }
+        ents[ent_count++] = names[0];
+    }
+    str_sort(ents, ent_count);
+    size_t unique = 0;
+    for (size_t i = 0; i < ent_count; i++) {
+        if (unique == 0 || strcmp(ents[i], ents[unique - 1]) != 0) {
+            ents[unique++] = ents[i];
+        }
+    }
+    ent_count = unique;
+
+    ht_soft_destroy(engine->mon_ent);
+    engine->mon_ent = ht_new(ht_size_for(ent_count, INITIAL_MON_ENT_SIZE));
+    str_arr_reserve(engine->mon_ent_list, ent_count, bulk_names_size(ents, ent_count));
+    for (size_t i = 0; i < ent_count; i++) {
+        add_ent(engine, ents[i]);
+    }
+
+    /*
+     * Edges, dropping those between entities that are not in the list
+     * */
+    size_t rel_count = 0, rels_size = INITIAL_BULK_RELS_SIZE;
+    char **rels = malloc(sizeof(char *) * rels_size);
+    struct hash_table *rel_index = ht_new(INITIAL_HASH_TABLE_SIZE);
+    size_t edge_count = 0, edges_size = INITIAL_BULK_EDGES_SIZE;
+    struct bulk_edge *edges = malloc(sizeof(struct bulk_edge) * edges_size);
+    if (rels == NULL || edges == NULL) {
+        exit(666);
+    }
+    pos = edge_buf;
+    while (*pos != '\0') {
+        if (bulk_next_line(&pos, names, 3) != 3) {
+            continue;
+        }
+        void *origin_value = ht_get(engine->mon_ent, names[0]);
+        void *dest_value = ht_get(engine->mon_ent, names[1]);
+        if (origin_value == NULL || dest_value == NULL) {
+            continue;
+        }
+        uint32_t *rel_id = ht_get(rel_index, names[2]);
+        if (rel_id == NULL) {
+            rel_id = malloc(sizeof(uint32_t));
+            if (rel_id == NULL) {
+                exit(666);
+            }
+            if (rel_count == rels_size) {
+                rels_size *= 2;
+                rels = realloc(rels, sizeof(char *) * rels_size);
+                if (rels == NULL) {
+                    exit(666);
+                }
+            }
+            *rel_id = (uint32_t) rel_count;
+            rels[rel_count++] = names[2];
+            ht_insert(rel_index, names[2], rel_id);
+        }
+        if (edge_count == edges_size) {
+            edges_size *= 2;
+            edges = realloc(edges, sizeof(struct bulk_edge) * edges_size);
+            if (edges == NULL) {
+                exit(666);
+            }
+        }
+        edges[edge_count].rel = *rel_id;
+        edges[edge_count].dest = ENT_VALUE_TO_ID(dest_value);
+        edges[edge_count].origin = ENT_VALUE_TO_ID(origin_value);
+        edge_count++;
+    }
+    qsort(edges, edge_count, sizeof(struct bulk_edge), compare_bulk_edges);
+    unique = 0;
+    for (size_t i = 0; i < edge_count; i++) {
+        if (unique == 0 || compare_bulk_edges(&edges[i], &edges[unique - 1]) != 0) {
+            edges[unique++] = edges[i];
+        }
+    }
+    edge_count = unique;
+
+    ht_soft_destroy(engine->mon_rel);
+    ht_soft_destroy(engine->cache);
+    engine->mon_rel = ht_new(ht_size_for(rel_count, INITIAL_MON_REL_SIZE));
+    engine->cache = ht_new(ht_size_for(rel_count, INITIAL_MON_REL_SIZE));
+    str_arr_reserve(engine->mon_rel_list, rel_count, bulk_names_size(rels, rel_count));
+
+    /*
+     * Edges of the same relationship and destination are now next to
+     * each other
+     * */
+    size_t i = 0;
+    while (i < edge_count) {
+        char *rel_name = rels[edges[i].rel];
+        size_t rel_end = i, dest_count = 0;
+        while (rel_end < edge_count && edges[rel_end].rel == edges[i].rel) {
+            if (rel_end == i || edges[rel_end].dest != edges[rel_end - 1].dest) {
+                dest_count++;
+            }
+            rel_end++;
+        }
+        struct dest_map *rel_table = dest_map_new(dest_count);
+        ht_insert_no_resize(engine->mon_rel, rel_name, rel_table);
+        rel_table->list_pos = engine->mon_rel_list->next_free;
+        str_arr_append(engine->mon_rel_list, rel_name);
+        struct report_cache *cache_entry = report_cache_new(1);
+
+        while (i < rel_end) {
+            uint32_t dest_id = edges[i].dest;
+            size_t dest_end = i;
+            while (dest_end < rel_end && edges[dest_end].dest == edges[i].dest) {
+                dest_end++;
+            }
+            size_t origin_count = dest_end - i;
+            uint32_t handle = edge_set_pool_new(&engine->sets, origin_count);
+            dest_map_insert(rel_table, dest_id, handle);
+            struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+            for (; i < dest_end; i++) {
+                edge_set_insert(dest_set, edges[i].origin);
+            }
+            if (origin_count > cache_entry->count) {
+                u32_vec_clear(&cache_entry->ents);
+                cache_entry->count = origin_count;
+            }
+            if (origin_count == cache_entry->count) {
+                u32_vec_push(&cache_entry->ents, dest_id);
+            }
+        }
+        ht_insert_no_resize(engine->cache, rel_name, cache_entry);
+    }
+
+    ht_destroy(rel_index);
+    free(ents);
+    free(rels);
+    free(edges);
+    free(edge_buf);
+    free(ent_buf);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef PROVAFINALEAPI_BULK_LOAD_H
+#define PROVAFINALEAPI_BULK_LOAD_H
+
+#include <stdint.h>
+#include "engine.h"
+
+#define INITIAL_BULK_EDGES_SIZE 65536
+#define INITIAL_BULK_RELS_SIZE 64
+
+/*
+ * An "arrow" read from an edge list: entities are referred to by
+ * their position in the sorted entity list, relationships by the
+ * order they were first seen in
+ * */
+struct bulk_edge {
+    uint32_t rel;
+    uint32_t dest;
+    uint32_t origin;
+};
+
+int bulk_load(struct engine *engine, const char *ent_path, const char *edge_path);
+
+#endif //PROVAFINALEAPI_BULK_LOAD_H
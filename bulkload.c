@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "engine.h"
+#include "persistence.h"
+#include "bulk_load.h"
+
+/*
+ * Seeds a new instance from an entity list and an edge list:
+ *
+ * bulkload entities edges [checkpoint]
+ *
+ * The state is built with bulk_load and written as a checkpoint
+ * (DEFAULT_CHECKPOINT_FILE by default), which provafinaleapi and
+ * provafinaleapi_server start from when given -c (or at startup
+ * when the WAL is enabled)
+ * */
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "usage: bulkload entities edges [checkpoint]\n");
+        exit(1);
+    }
+    const char *path = argc == 4 ? argv[3] : DEFAULT_CHECKPOINT_FILE;
+    struct timespec start, end;
+    struct engine *engine = engine_new();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int ret = bulk_load(engine, argv[1], argv[2]);
+    if (ret == -2) {
+        fprintf(stderr, "bulkload: the state to load into is not empty\n");
+        exit(1);
+    } else if (ret != 0) {
+        fprintf(stderr, "bulkload: could not read %s or %s\n", argv[1], argv[2]);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (checkpoint(engine, path) != 0) {
+        fprintf(stderr, "bulkload: could not write %s\n", path);
+        exit(1);
+    }
+    fprintf(stderr, "bulkload: %lu entities, %lu relationships loaded in %.3f ms\n",
+            engine->mon_ent_list->next_free, engine->mon_rel_list->next_free,
+            (double) (end.tv_sec - start.tv_sec) * 1000 + (double) (end.tv_nsec - start.tv_nsec) / 1000000);
+    engine_destroy(engine);
+    return 0;
+}
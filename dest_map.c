@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dest_map.h"
+#include "slab.h"
+
+/*
+ * Fibonacci hashing: the top bits of the product are spread
+ * out for consecutive ids as well as for evenly spaced ones
+ * */
+static inline uint32_t dest_map_index(struct dest_map *map, uint32_t dest) {
+    return (uint32_t) ((dest * 2654435769u) >> (32 - __builtin_ctz(map->size)));
+}
+
+static void dest_map_alloc_slots(struct dest_map *map, uint32_t size) {
+    map->slots = malloc(sizeof(struct dest_slot) * size);
+    if (map->slots == NULL) {
+        exit(666);
+    }
+    memset(map->slots, 0xff, sizeof(struct dest_slot) * size);
+    map->size = size;
+}
+
+/*
+ * Returns a map that can hold count destinations without growing
+ * */
+struct dest_map *dest_map_new(size_t count) {
+    struct dest_map *map = slab_alloc(sizeof(struct dest_map));
+    uint32_t size = INITIAL_DEST_MAP_SIZE;
+    while (count >= (size_t) size * DEST_MAP_RESIZE_THRESHOLD_PERCENTAGE / 100) {
+        size *= DEST_MAP_GROWTH_FACTOR;
+    }
+    dest_map_alloc_slots(map, size);
+    map->count = 0;
+    map->list_pos = 0;
+    return map;
+}
+
+/*
+ * Returns the handle of the set for dest, or DEST_MAP_NONE
+ * */
+uint32_t dest_map_get(struct dest_map *map, uint32_t dest) {
+    uint32_t index = dest_map_index(map, dest);
+    while (map->slots[index].dest != DEST_MAP_NONE) {
+        if (map->slots[index].dest == dest) {
+            return map->slots[index].set;
+        }
+        index = (index + 1) & (map->size - 1);
+    }
+    return DEST_MAP_NONE;
+}
+
+static void dest_map_resize(struct dest_map *map, uint32_t new_size) {
+    struct dest_slot *old_slots = map->slots;
+    uint32_t old_size = map->size;
+    dest_map_alloc_slots(map, new_size);
+    for (uint32_t i = 0; i < old_size; i++) {
+        if (old_slots[i].dest != DEST_MAP_NONE) {
+            uint32_t index = dest_map_index(map, old_slots[i].dest);
+            while (map->slots[index].dest != DEST_MAP_NONE) {
+                index = (index + 1) & (map->size - 1);
+            }
+            map->slots[index] = old_slots[i];
+        }
+    }
+    slab_heap_free(old_slots);
+}
+
+/*
+ * Maps dest to set: dest must not be in map already
+ * */
+void dest_map_insert(struct dest_map *map, uint32_t dest, uint32_t set) {
+    if (map->count + 1 >= (size_t) map->size * DEST_MAP_RESIZE_THRESHOLD_PERCENTAGE / 100) {
+        dest_map_resize(map, map->size * DEST_MAP_GROWTH_FACTOR);
+    }
+    uint32_t index = dest_map_index(map, dest);
+    while (map->slots[index].dest != DEST_MAP_NONE) {
+        index = (index + 1) & (map->size - 1);
+    }
+    map->slots[index].dest = dest;
+    map->slots[index].set = set;
+    map->count++;
+}
+
+/*
+ * Returns 0 if dest was not in map, 1 otherwise.
+ * The slots after the deleted one are moved back if they'd be found
+ * from there, so that lookups can keep stopping at the first empty slot
+ * */
+int dest_map_delete(struct dest_map *map, uint32_t dest) {
+    uint32_t mask = map->size - 1;
+    uint32_t index = dest_map_index(map, dest);
+    while (map->slots[index].dest != dest) {
+        if (map->slots[index].dest == DEST_MAP_NONE) {
+            return 0;
+        }
+        index = (index + 1) & mask;
+    }
+    uint32_t hole = index;
+    for (index = (hole + 1) & mask; map->slots[index].dest != DEST_MAP_NONE; index = (index + 1) & mask) {
+        uint32_t home = dest_map_index(map, map->slots[index].dest);
+        /*
+         * The slot can fill the hole unless its home is
+         * after the hole (going around the end)
+         * */
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            map->slots[hole] = map->slots[index];
+            hole = index;
+        }
+    }
+    map->slots[hole].dest = DEST_MAP_NONE;
+    map->count--;
+    return 1;
+}
+
+/*
+ * Iterates on the destinations in no particular order: pos must start
+ * at 0. Returns 0 once there are no more. Deleting while iterating
+ * can move destinations that weren't visited yet before pos
+ * */
+int dest_map_next(struct dest_map *map, size_t *pos, uint32_t *dest, uint32_t *set) {
+    while (*pos < map->size) {
+        struct dest_slot *slot = &map->slots[(*pos)++];
+        if (slot->dest != DEST_MAP_NONE) {
+            *dest = slot->dest;
+            *set = slot->set;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void dest_map_destroy(struct dest_map *map) {
+    slab_heap_free(map->slots);
+    slab_free(map, sizeof(struct dest_map));
+}
@@ -0,0 +1,48 @@
+#ifndef PROVAFINALEAPI_DEST_MAP_H
+#define PROVAFINALEAPI_DEST_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INITIAL_DEST_MAP_SIZE 8
+#define DEST_MAP_RESIZE_THRESHOLD_PERCENTAGE 70
+#define DEST_MAP_GROWTH_FACTOR 2
+
+/*
+ * Marks empty slots, and is what dest_map_get returns for a missing
+ * destination (entity ids never get this high)
+ * */
+#define DEST_MAP_NONE UINT32_MAX
+
+struct dest_slot {
+    uint32_t dest;
+    uint32_t set;
+};
+
+/*
+ * The destinations of one relationship: maps the id of every entity
+ * with "arrows" going to it to the handle of the edge_set of their
+ * origins. Slots are two 32-bit values, probed linearly, and deleting
+ * shifts the following ones back instead of leaving a marker.
+ * list_pos is the position of the relationship in mon_rel_list
+ * */
+struct dest_map {
+    struct dest_slot *slots;
+    uint32_t size;
+    uint32_t count;
+    unsigned long int list_pos;
+};
+
+struct dest_map *dest_map_new(size_t count);
+
+uint32_t dest_map_get(struct dest_map *map, uint32_t dest);
+
+void dest_map_insert(struct dest_map *map, uint32_t dest, uint32_t set);
+
+int dest_map_delete(struct dest_map *map, uint32_t dest);
+
+int dest_map_next(struct dest_map *map, size_t *pos, uint32_t *dest, uint32_t *set);
+
+void dest_map_destroy(struct dest_map *map);
+
+#endif //PROVAFINALEAPI_DEST_MAP_H
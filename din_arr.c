@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "din_arr.h"
+#include "str_sort.h"
+
+int compare_strings(const void *a, const void *b) {
+    const char *pa = *(const char **) a;
+    const char *pb = *(const char **) b;
+
+    return strcmp(pa, pb);
+}
+
+
+struct din_arr *din_arr_new(size_t initial_size) {
+    struct din_arr *arr = malloc(sizeof(struct din_arr));
+    if (arr == NULL) {
+        exit(666);
+    }
+    arr->array = calloc(initial_size, sizeof(void *));
+    if (arr->array == NULL) {
+        exit(666);
+    }
+    arr->size = initial_size;
+    arr->next_free = 0;
+    return arr;
+}
+
+size_t din_arr_resize(struct din_arr *arr, size_t new_size) {
+    if (new_size <= arr->size) {
+        return arr->size;
+    }
+    arr->array = realloc(arr->array, sizeof(void *) * new_size);
+    if (arr->array == NULL) {
+        exit(666);
+    }
+    arr->size = new_size;
+    return new_size;
+}
+
+/*
+ * Appends elem itself rather than a copy of it: arrays filled this
+ * way don't own their elements, and are emptied with
+ * din_arr_soft_clear and freed with din_arr_soft_destroy
+ * */
+void din_arr_push(struct din_arr *arr, void *elem) {
+    if (arr->next_free >= arr->size * DA_RESIZE_THRESHOLD_PERCENTAGE / 100) {
+        size_t old_size = arr->size;
+        size_t new_size = din_arr_resize(arr, arr->size * DA_GROWTH_FACTOR);
+        if (new_size <= old_size) {
+            exit(666);
+        }
+    }
+    arr->array[arr->next_free] = elem;
+    arr->next_free++;
+}
+
+void din_arr_append(struct din_arr *arr, void *elem, size_t elem_size) {
+    void *copy = malloc(elem_size);
+    if (copy == NULL) {
+        exit(666);
+    }
+    memcpy(copy, elem, elem_size);
+    din_arr_push(arr, copy);
+}
+
+void din_arr_remove(struct din_arr *arr, void *elem, int (*cmp)(void *, void *)) {
+    for (size_t i = 0; i < arr->next_free; i++) {
+        if (cmp(arr->array[i], elem) == 0) {
+            free(arr->array[i]);
+            arr->array[i] = arr->array[--arr->next_free];
+        }
+    }
+}
+
+/*
+ * Empties an array filled with din_arr_push, keeping its room
+ * */
+void din_arr_soft_clear(struct din_arr *arr) {
+    arr->next_free = 0;
+}
+
+void din_arr_sort(struct din_arr *arr, int (*cmp)(const void *a, const void *b)) {
+    qsort(arr->array, arr->next_free, sizeof(void *), cmp);
+}
+
+/*
+ * Sorts an array of strings like din_arr_sort with compare_strings
+ * would, without going through strcmp for every comparison
+ * */
+void din_arr_sort_strings(struct din_arr *arr) {
+    str_sort((char **) arr->array, arr->next_free);
+}
+
+void din_arr_zero(struct din_arr *arr) {
+    for (size_t i = 0; i < arr->next_free; i++) {
+        free(arr->array[i]);
+        arr->array[i] = NULL;
+    }
+    arr->next_free = 0;
+    arr->size = 0;
+}
+
+void din_arr_print(struct din_arr *arr) {
+    printf("\n[");
+    for (size_t i = 0; i < arr->next_free; i++) {
+        if (arr->array[i] != NULL) {
+            printf("'%s', ", arr->array[i]);
+        }
+    }
+    printf("]\n");
+}
+
+void din_arr_destroy(struct din_arr *arr) {
+    size_t i;
+    for (i = 0; i < arr->next_free; i++) {
+        free(arr->array[i]);
+    }
+    free(arr->array);
+    free(arr);
+}
+
+void din_arr_soft_destroy(struct din_arr *arr) {
+    free(arr->array);
+    free(arr);
+}
+
@@ -0,0 +1,42 @@
+#ifndef PROVAFINALEAPI_DIN_ARR_H
+#define PROVAFINALEAPI_DIN_ARR_H
+
+#include <stddef.h>
+
+#define DA_RESIZE_THRESHOLD_PERCENTAGE 98
+#define DA_GROWTH_FACTOR 2
+#define INITIAL_DA_SIZE 100
+
+struct din_arr {
+    void **array;
+    unsigned long int next_free;
+    size_t size;
+};
+
+int compare_strings(const void *a, const void *b);
+
+struct din_arr *din_arr_new(size_t initial_size);
+
+size_t din_arr_resize(struct din_arr *arr, size_t new_size);
+
+void din_arr_append(struct din_arr *arr, void *elem, size_t elem_size);
+
+void din_arr_push(struct din_arr *arr, void *elem);
+
+void din_arr_remove(struct din_arr *arr, void *elem, int (*cmp)(void *, void *));
+
+void din_arr_soft_clear(struct din_arr *arr);
+
+void din_arr_sort(struct din_arr *arr, int (*cmp)(const void *a, const void *b));
+
+void din_arr_sort_strings(struct din_arr *arr);
+
+void din_arr_zero(struct din_arr *arr);
+
+void din_arr_print(struct din_arr *arr);
+
+void din_arr_destroy(struct din_arr *arr);
+
+void din_arr_soft_destroy(struct din_arr *arr);
+
+#endif //PROVAFINALEAPI_DIN_ARR_H
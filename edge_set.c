@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <string.h>
+#include "edge_set.h"
+#include "slab.h"
+
+void edge_set_init(struct edge_set *set, size_t initial_size) {
+    if (initial_size == 0) {
+        initial_size = 1;
+    }
+    set->ids = slab_alloc(sizeof(uint32_t) * initial_size);
+    set->bits = NULL;
+    set->count = 0;
+    set->size = (uint32_t) initial_size;
+}
+
+/*
+ * Returns the position of id in the sorted array,
+ * or the one it would be inserted at
+ * */
+static size_t edge_set_search(struct edge_set *set, uint32_t id) {
+    size_t low = 0, high = set->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (set->ids[mid] < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void edge_set_to_bitmap(struct edge_set *set, size_t words) {
+    uint64_t *bits = slab_alloc(sizeof(uint64_t) * words);
+    memset(bits, 0, sizeof(uint64_t) * words);
+    for (size_t i = 0; i < set->count; i++) {
+        bits[set->ids[i] / 64] |= (uint64_t) 1 << (set->ids[i] % 64);
+    }
+    slab_free(set->ids, sizeof(uint32_t) * set->size);
+    set->ids = NULL;
+    set->bits = bits;
+    set->size = words;
+}
+
+static void edge_set_to_array(struct edge_set *set, size_t size) {
+    uint32_t *ids = slab_alloc(sizeof(uint32_t) * size);
+    size_t n = 0, pos = 0;
+    uint32_t id;
+    while (edge_set_next(set, &pos, &id)) {
+        ids[n++] = id;
+    }
+    slab_free(set->bits, sizeof(uint64_t) * set->size);
+    set->bits = NULL;
+    set->ids = ids;
+    set->size = size;
+}
+
+int edge_set_contains(struct edge_set *set, uint32_t id) {
+    if (set->bits != NULL) {
+        return id / 64 < set->size && (set->bits[id / 64] >> (id % 64)) & 1;
+    }
+    size_t pos = edge_set_search(set, id);
+    return pos < set->count && set->ids[pos] == id;
+}
+
+/*
+ * Returns 0 if id was not already in set, 1 otherwise
+ * */
+int edge_set_insert(struct edge_set *set, uint32_t id) {
+    if (set->bits != NULL) {
+        size_t word = id / 64;
+        if (word >= set->size) {
+            size_t words = set->size * EDGE_SET_GROWTH_FACTOR;
+            if (words <= word) {
+                words = word + 1;
+            }
+            /*
+             * If the ids are too far apart the array is smaller
+             * */
+            if ((set->count + 1) * sizeof(uint32_t) < words * sizeof(uint64_t) / 2) {
+                edge_set_to_array(set, (set->count + 1) * EDGE_SET_GROWTH_FACTOR);
+                return edge_set_insert(set, id);
+            }
+            set->bits = slab_realloc(set->bits, sizeof(uint64_t) * set->size, sizeof(uint64_t) * words);
+            memset(set->bits + set->size, 0, sizeof(uint64_t) * (words - set->size));
+            set->size = words;
+        }
+        uint64_t mask = (uint64_t) 1 << (id % 64);
+        if (set->bits[word] & mask) {
+            return 1;
+        }
+        set->bits[word] |= mask;
+        set->count++;
+        return 0;
+    }
+
+    size_t pos = edge_set_search(set, id);
+    if (pos < set->count && set->ids[pos] == id) {
+        return 1;
+    }
+    if (set->count == set->size) {
+        size_t size = set->size * EDGE_SET_GROWTH_FACTOR;
+        uint32_t max_id = set->count > 0 && set->ids[set->count - 1] > id ? set->ids[set->count - 1] : id;
+        size_t words = (size_t) max_id / 64 + 1;
+        /*
+         * If the ids are close enough the bitmap is smaller
+         * */
+        if (words * sizeof(uint64_t) <= size * sizeof(uint32_t)) {
+            edge_set_to_bitmap(set, words);
+            return edge_set_insert(set, id);
+        }
+        set->ids = slab_realloc(set->ids, sizeof(uint32_t) * set->size, sizeof(uint32_t) * size);
+        set->size = size;
+    }
+    memmove(set->ids + pos + 1, set->ids + pos, sizeof(uint32_t) * (set->count - pos));
+    set->ids[pos] = id;
+    set->count++;
+    return 0;
+}
+
+/*
+ * Returns 0 if id was not in set, 1 otherwise
+ * */
+int edge_set_delete(struct edge_set *set, uint32_t id) {
+    if (set->bits != NULL) {
+        uint64_t mask = (uint64_t) 1 << (id % 64);
+        if (id / 64 >= set->size || !(set->bits[id / 64] & mask)) {
+            return 0;
+        }
+        set->bits[id / 64] &= ~mask;
+        set->count--;
+        if (set->count * sizeof(uint32_t) < set->size * sizeof(uint64_t) / 4) {
+            edge_set_to_array(set, set->count * EDGE_SET_GROWTH_FACTOR + INITIAL_EDGE_SET_SIZE);
+        }
+        return 1;
+    }
+
+    size_t pos = edge_set_search(set, id);
+    if (pos >= set->count || set->ids[pos] != id) {
+        return 0;
+    }
+    set->count--;
+    memmove(set->ids + pos, set->ids + pos + 1, sizeof(uint32_t) * (set->count - pos));
+    if (set->size > INITIAL_EDGE_SET_SIZE && set->count < set->size / 4) {
+        set->ids = slab_realloc(set->ids, sizeof(uint32_t) * set->size,
+                                sizeof(uint32_t) * (set->size / EDGE_SET_GROWTH_FACTOR));
+        set->size /= EDGE_SET_GROWTH_FACTOR;
+    }
+    return 1;
+}
+
+/*
+ * Iterates on the ids in ascending order: pos must start at 0.
+ * Returns 0 once there are no more ids
+ * */
+int edge_set_next(struct edge_set *set, size_t *pos, uint32_t *id) {
+    if (set->bits == NULL) {
+        if (*pos >= set->count) {
+            return 0;
+        }
+        *id = set->ids[(*pos)++];
+        return 1;
+    }
+    for (size_t word = *pos / 64; word < set->size; word++) {
+        uint64_t rest = set->bits[word];
+        if (word == *pos / 64) {
+            rest &= ~(uint64_t) 0 << (*pos % 64);
+        }
+        if (rest != 0) {
+            *id = (uint32_t) (word * 64 + __builtin_ctzll(rest));
+            *pos = (size_t) *id + 1;
+            return 1;
+        }
+    }
+    *pos = (size_t) set->size * 64;
+    return 0;
+}
+
+size_t edge_set_bytes(struct edge_set *set) {
+    if (set->bits != NULL) {
+        return sizeof(struct edge_set) + sizeof(uint64_t) * set->size;
+    }
+    return sizeof(struct edge_set) + sizeof(uint32_t) * set->size;
+}
+
+/*
+ * Frees the ids or the bitmap of set, but not set itself
+ * */
+void edge_set_release(struct edge_set *set) {
+    if (set->bits != NULL) {
+        slab_free(set->bits, sizeof(uint64_t) * set->size);
+    } else {
+        slab_free(set->ids, sizeof(uint32_t) * set->size);
+    }
+}
+
+void edge_set_pool_init(struct edge_set_pool *pool, uint32_t initial_size) {
+    pool->sets = malloc(sizeof(struct edge_set) * initial_size);
+    if (pool->sets == NULL) {
+        exit(666);
+    }
+    pool->count = 0;
+    pool->size = initial_size;
+    u32_vec_init(&pool->free_handles, INITIAL_VEC_SIZE);
+}
+
+/*
+ * Returns the handle of a new, empty set
+ * */
+uint32_t edge_set_pool_new(struct edge_set_pool *pool, size_t initial_size) {
+    uint32_t handle;
+    if (pool->free_handles.len > 0) {
+        handle = u32_vec_pop(&pool->free_handles);
+    } else {
+        if (pool->count == pool->size) {
+            pool->sets = slab_heap_realloc(pool->sets, sizeof(struct edge_set) * pool->size,
+                                           sizeof(struct edge_set) * pool->size * EDGE_SET_GROWTH_FACTOR);
+            pool->size *= EDGE_SET_GROWTH_FACTOR;
+            if (pool->sets == NULL) {
+                exit(666);
+            }
+        }
+        handle = pool->count++;
+    }
+    edge_set_init(&pool->sets[handle], initial_size);
+    return handle;
+}
+
+void edge_set_pool_delete(struct edge_set_pool *pool, uint32_t handle) {
+    edge_set_release(&pool->sets[handle]);
+    u32_vec_push(&pool->free_handles, handle);
+}
+
+/*
+ * Frees the pool itself: the sets still in it must have been
+ * released already
+ * */
+void edge_set_pool_destroy(struct edge_set_pool *pool) {
+    slab_heap_free(pool->sets);
+    u32_vec_destroy(&pool->free_handles);
+}
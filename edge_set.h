@@ -0,0 +1,64 @@
+#ifndef PROVAFINALEAPI_EDGE_SET_H
+#define PROVAFINALEAPI_EDGE_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vec.h"
+
+#define INITIAL_EDGE_SET_SIZE 4
+#define EDGE_SET_GROWTH_FACTOR 2
+
+/*
+ * The origins of the "arrows" going to one destination, by entity id.
+ * Small or sparse sets are a sorted array of ids (ids, size is its
+ * capacity), dense ones a bitmap (bits, size is its number of words):
+ * a set switches to whichever takes less memory as it grows and shrinks
+ * */
+struct edge_set {
+    uint32_t *ids;
+    uint64_t *bits;
+    uint32_t count;
+    uint32_t size;
+};
+
+/*
+ * Holds the edge sets of every relationship, which are referred to by
+ * 32-bit handles rather than by pointer. sets grows by reallocation,
+ * so a pointer from edge_set_pool_get is only good until the next
+ * edge_set_pool_new. Handles of deleted sets go in free_handles and
+ * are given out again first
+ * */
+struct edge_set_pool {
+    struct edge_set *sets;
+    uint32_t count;
+    uint32_t size;
+    struct u32_vec free_handles;
+};
+
+void edge_set_init(struct edge_set *set, size_t initial_size);
+
+int edge_set_contains(struct edge_set *set, uint32_t id);
+
+int edge_set_insert(struct edge_set *set, uint32_t id);
+
+int edge_set_delete(struct edge_set *set, uint32_t id);
+
+int edge_set_next(struct edge_set *set, size_t *pos, uint32_t *id);
+
+size_t edge_set_bytes(struct edge_set *set);
+
+void edge_set_release(struct edge_set *set);
+
+void edge_set_pool_init(struct edge_set_pool *pool, uint32_t initial_size);
+
+uint32_t edge_set_pool_new(struct edge_set_pool *pool, size_t initial_size);
+
+static inline struct edge_set *edge_set_pool_get(struct edge_set_pool *pool, uint32_t handle) {
+    return &pool->sets[handle];
+}
+
+void edge_set_pool_delete(struct edge_set_pool *pool, uint32_t handle);
+
+void edge_set_pool_destroy(struct edge_set_pool *pool);
+
+#endif //PROVAFINALEAPI_EDGE_SET_H
@@ -0,0 +1,1007 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "persistence.h"
+#include "slab.h"
+
+VEC_DEFINE(rel_vec, struct dest_map *)
+
+struct report_cache *report_cache_new(size_t size) {
+    struct report_cache *cache = malloc(sizeof(struct report_cache));
+    if (cache == NULL) {
+        exit(666);
+    }
+    u32_vec_init(&cache->ents, size);
+    cache->count = 0;
+    cache->text = NULL;
+    cache->text_len = 0;
+    cache->changed_seq = 0;
+    cache->rendered_seq = 0;
+    return cache;
+}
+
+void report_cache_set_text(struct report_cache *cache, const char *text, size_t len,
+                           unsigned long long int seq) {
+    cache->text = slab_heap_realloc(cache->text, cache->text_len, len);
+    if (cache->text == NULL) {
+        exit(666);
+    }
+    memcpy(cache->text, text, len);
+    cache->text_len = len;
+    cache->rendered_seq = seq;
+}
+
+void report_cache_destroy(struct report_cache *cache) {
+    u32_vec_destroy(&cache->ents);
+    slab_heap_free(cache->text);
+    slab_heap_free(cache);
+}
+
+struct report_snapshot *report_snapshot_new(size_t initial_size) {
+    struct report_snapshot *snapshot = malloc(sizeof(struct report_snapshot));
+    if (snapshot == NULL) {
+        exit(666);
+    }
+    snapshot->buf = malloc(initial_size);
+    if (snapshot->buf == NULL) {
+        exit(666);
+    }
+    snapshot->len = 0;
+    snapshot->size = initial_size;
+    snapshot->op_seq = 1;
+    snapshot->rendered_seq = 0;
+    return snapshot;
+}
+
+void report_snapshot_append(struct report_snapshot *snapshot, const char *str, size_t len) {
+    if (snapshot->len + len > snapshot->size) {
+        size_t new_size = snapshot->size * SNAPSHOT_GROWTH_FACTOR;
+        while (snapshot->len + len > new_size) {
+            new_size *= SNAPSHOT_GROWTH_FACTOR;
+        }
+        snapshot->buf = realloc(snapshot->buf, new_size);
+        if (snapshot->buf == NULL) {
+            exit(666);
+        }
+        snapshot->size = new_size;
+    }
+    memcpy(snapshot->buf + snapshot->len, str, len);
+    snapshot->len += len;
+}
+
+/*
+ * Appends "name" followed by a space
+ * */
+void report_snapshot_append_quoted(struct report_snapshot *snapshot, const char *name) {
+    size_t len = strlen(name);
+    report_snapshot_append(snapshot, "\"", 1);
+    report_snapshot_append(snapshot, name, len);
+    report_snapshot_append(snapshot, "\" ", 2);
+}
+
+void report_snapshot_append_count(struct report_snapshot *snapshot, unsigned long int count) {
+    char digits[24];
+    size_t n = sizeof(digits);
+    do {
+        digits[--n] = (char) ('0' + count % 10);
+        count /= 10;
+    } while (count > 0);
+    report_snapshot_append(snapshot, digits + n, sizeof(digits) - n);
+}
+
+void report_snapshot_destroy(struct report_snapshot *snapshot) {
+    free(snapshot->buf);
+    free(snapshot);
+}
+
+struct command_batch *command_batch_new(void) {
+    struct command_batch *batch = malloc(sizeof(struct command_batch));
+    if (batch == NULL) {
+        exit(666);
+    }
+    batch->commands = malloc(sizeof(struct command) * MAX_BATCH_COMMANDS);
+    batch->names = malloc(BATCH_NAMES_SIZE);
+    if (batch->commands == NULL || batch->names == NULL) {
+        exit(666);
+    }
+    batch->count = 0;
+    batch->names_len = 0;
+    return batch;
+}
+
+void command_batch_destroy(struct command_batch *batch) {
+    free(batch->commands);
+    free(batch->names);
+    free(batch);
+}
+
+/*
+ * Orders commands by relationship, destination and origin, and
+ * commands on the same "arrow" in the order they were received
+ * */
+static int compare_batch_commands(const void *a, const void *b) {
+    const struct command *cmd_a = a, *cmd_b = b;
+    int cmp = strcmp(cmd_a->params[2], cmd_b->params[2]);
+    if (cmp == 0) {
+        cmp = strcmp(cmd_a->params[1], cmd_b->params[1]);
+    }
+    if (cmp == 0) {
+        cmp = strcmp(cmd_a->params[0], cmd_b->params[0]);
+    }
+    if (cmp == 0) {
+        cmp = (cmd_a->params[0] > cmd_b->params[0]) - (cmd_a->params[0] < cmd_b->params[0]);
+    }
+    return cmp;
+}
+
+/*
+ * Applies the net effect of the pending addrel and delrel commands:
+ * only the last command on each "arrow" matters, since adding or
+ * deleting it twice is the same as doing it once. They're applied
+ * sorted, so all the changes to a relationship and destination
+ * come one after the other
+ * */
+void engine_flush(struct engine *engine) {
+    struct command_batch *batch = engine->batch;
+    if (batch == NULL || batch->count == 0) {
+        return;
+    }
+    qsort(batch->commands, batch->count, sizeof(struct command), compare_batch_commands);
+    for (size_t i = 0; i < batch->count; i++) {
+        struct command *command = &batch->commands[i];
+        if (i + 1 < batch->count && strcmp(command->params[0], batch->commands[i + 1].params[0]) == 0 &&
+            strcmp(command->params[1], batch->commands[i + 1].params[1]) == 0 &&
+            strcmp(command->params[2], batch->commands[i + 1].params[2]) == 0) {
+            continue;
+        }
+        if (command->action == CMD_ADD_REL) {
+            add_rel(engine, command->params[0], command->params[1], command->params[2]);
+        } else {
+            del_rel(engine, command->params[0], command->params[1], command->params[2]);
+        }
+    }
+    batch->count = 0;
+    batch->names_len = 0;
+}
+
+static char *batch_copy_name(struct command_batch *batch, const char *name, size_t len) {
+    char *copy = batch->names + batch->names_len;
+    memcpy(copy, name, len);
+    batch->names_len += len;
+    return copy;
+}
+
+/*
+ * ht_get on mon_ent, except that the names ent_filter rules out
+ * aren't looked for (while it's active)
+ * */
+static void *ent_get(struct engine *engine, char *name) {
+    struct bloom *filter = &engine->ent_filter;
+    unsigned long long int hash = ht_hash(name);
+    void *value = NULL;
+    if (!filter->active || bloom_may_contain(filter, hash)) {
+        value = ht_get_hashed(engine->mon_ent, name, hash);
+    }
+    bloom_record(filter, value != NULL);
+    return value;
+}
+
+/*
+ * Holds back an addrel or delrel command.
+ * An addrel between entities that aren't monitored is dropped right
+ * away: only a delent could change that, and it flushes the batch first
+ * */
+static void batch_rel(struct engine *engine, int action, char *origin_ent, char *dest_ent, char *rel_name) {
+    struct command_batch *batch = engine->batch;
+    if (action == CMD_ADD_REL && (ent_get(engine, origin_ent) == NULL ||
+                                  ent_get(engine, dest_ent) == NULL)) {
+        return;
+    }
+    size_t origin_len = strlen(origin_ent) + 1, dest_len = strlen(dest_ent) + 1, rel_len = strlen(rel_name) + 1;
+    if (origin_len + dest_len + rel_len > BATCH_NAMES_SIZE) {
+        engine_flush(engine);
+        if (action == CMD_ADD_REL) {
+            add_rel(engine, origin_ent, dest_ent, rel_name);
+        } else {
+            del_rel(engine, origin_ent, dest_ent, rel_name);
+        }
+        return;
+    }
+    if (batch->count == MAX_BATCH_COMMANDS || batch->names_len + origin_len + dest_len + rel_len > BATCH_NAMES_SIZE) {
+        engine_flush(engine);
+    }
+    struct command *command = &batch->commands[batch->count++];
+    command->action = action;
+    command->params[0] = batch_copy_name(batch, origin_ent, origin_len);
+    command->params[1] = batch_copy_name(batch, dest_ent, dest_len);
+    command->params[2] = batch_copy_name(batch, rel_name, rel_len);
+}
+
+/*
+ * Turning coalescing off applies whatever is still pending
+ * */
+void engine_set_coalescing(struct engine *engine, int enabled) {
+    if (enabled && engine->batch == NULL) {
+        engine->batch = command_batch_new();
+    } else if (!enabled && engine->batch != NULL) {
+        engine_flush(engine);
+        command_batch_destroy(engine->batch);
+        engine->batch = NULL;
+    }
+}
+
+/*
+ * Gives name (the key of its item in mon_ent) an id,
+ * reusing the ones of deleted entities first
+ * */
+static uint32_t ent_id_new(struct engine *engine, char *name) {
+    uint32_t id;
+    if (engine->free_ids.len > 0) {
+        id = u32_vec_pop(&engine->free_ids);
+    } else {
+        if (engine->next_ent_id == engine->ent_ids_size) {
+            size_t old_size = engine->ent_ids_size;
+            engine->ent_ids_size *= ENT_IDS_GROWTH_FACTOR;
+            engine->ent_names = slab_heap_realloc(engine->ent_names, sizeof(char *) * old_size,
+                                                  sizeof(char *) * engine->ent_ids_size);
+            engine->ent_pos = slab_heap_realloc(engine->ent_pos, sizeof(uint32_t) * old_size,
+                                                sizeof(uint32_t) * engine->ent_ids_size);
+            if (engine->ent_names == NULL || engine->ent_pos == NULL) {
+                exit(666);
+            }
+        }
+        id = engine->next_ent_id++;
+    }
+    engine->ent_names[id] = name;
+    return id;
+}
+
+/*
+ * Removes the relationship whose table is rel_table from mon_rel_list
+ * */
+static void rel_list_remove(struct engine *engine, struct dest_map *rel_table) {
+    struct str_arr *mon_rel_list = engine->mon_rel_list;
+    unsigned long int pos = rel_table->list_pos;
+    str_arr_remove_at(mon_rel_list, pos);
+    if (pos < mon_rel_list->next_free) {
+        struct dest_map *moved = ht_get(engine->mon_rel, str_arr_get(mon_rel_list, pos));
+        moved->list_pos = pos;
+    }
+}
+
+/*
+ * Adds the entity with hash, already in mon_ent, to ent_filter. Once the
+ * filter is full it's filled again from mon_ent, sized for twice as many
+ * entities as there are: deleted entities are only dropped then
+ * */
+static void ent_filter_add(struct engine *engine, unsigned long long int hash) {
+    if (!bloom_full(&engine->ent_filter)) {
+        bloom_add(&engine->ent_filter, hash);
+        return;
+    }
+    size_t capacity = INITIAL_BLOOM_CAPACITY;
+    while (capacity < engine->mon_ent->count * 2) {
+        capacity *= 2;
+    }
+    bloom_reset(&engine->ent_filter, capacity);
+    unsigned long int pos = 0;
+    struct ht_item *item;
+    while (ht_next(engine->mon_ent, &pos, &item)) {
+        bloom_add(&engine->ent_filter, ht_hash(item->key));
+    }
+}
+
+static void ent_id_free(struct engine *engine, uint32_t id) {
+    engine->ent_names[id] = NULL;
+    u32_vec_push(&engine->free_ids, id);
+}
+
+void add_ent(struct engine *engine, char *entity_name) {
+    struct hash_table *mon_ent = engine->mon_ent;
+    struct str_arr *mon_ent_list = engine->mon_ent_list;
+    if (engine->wal != NULL) {
+        wal_append(engine->wal, CMD_ADD_ENT, entity_name, NULL, NULL);
+    }
+    /*
+     * Check if entity_name is being monitored
+     * */
+    unsigned long long int hash = ht_hash(entity_name);
+    if (!bloom_may_contain(&engine->ent_filter, hash) || ht_get_hashed(mon_ent, entity_name, hash) == NULL) {
+        /*
+         * If not, start monitoring it
+         * */
+        ht_insert(mon_ent, entity_name, NULL);
+        struct ht_item *item = ht_get_item(mon_ent, entity_name);
+        uint32_t id = ent_id_new(engine, item->key);
+        item->value = ENT_ID_TO_VALUE(id);
+        ent_filter_add(engine, hash);
+        art_insert(&engine->ent_index, item);
+        struct ht_item *next = art_successor(&engine->ent_index, item->key);
+        order_insert_before(&engine->ent_order, id, next == NULL ? ORDER_NONE : ENT_VALUE_TO_ID(next->value));
+        engine->ent_pos[id] = (uint32_t) mon_ent_list->next_free;
+        str_arr_append(mon_ent_list, entity_name);
+    }
+}
+
+void add_rel(struct engine *engine, char *origin_ent, char *dest_ent, char *rel_name) {
+    struct hash_table *mon_rel = engine->mon_rel, *cache = engine->cache;
+    struct str_arr *mon_rel_list = engine->mon_rel_list;
+    struct report_snapshot *snapshot = engine->snapshot;
+    if (engine->wal != NULL) {
+        wal_append(engine->wal, CMD_ADD_REL, origin_ent, dest_ent, rel_name);
+    }
+    /*if (strcmp(dest_ent, "dotarono_interrogativi") == 0) {
+        printf("ALLARME!\n");
+    }*/
+    /*
+     * Check if both origin_ent and dest_ent
+     * are being monitored (dest_ent only if origin_ent is)
+     * */
+    void *origin_value = ent_get(engine, origin_ent);
+    void *dest_value = origin_value != NULL ? ent_get(engine, dest_ent) : NULL;
+    if (origin_value != NULL && dest_value != NULL) {
+        /*
+         * Try to retrieve the hash table for rel_name
+         * */
+        struct dest_map *rel_table = ht_get(mon_rel, rel_name);
+        if (rel_table == NULL) {
+            /*
+             * If we get here, rel_name was not being monitored:
+             * we instantiate a new map for it and insert
+             * it into mon_rel
+             * */
+            rel_table = dest_map_new(0);
+            ht_insert(mon_rel, rel_name, rel_table);
+            rel_table->list_pos = mon_rel_list->next_free;
+            str_arr_append(mon_rel_list, rel_name);
+        }
+        /*
+         * We try to retrieve the set of all entities
+         * that are in rel_name with dest_ent
+         * */
+        uint32_t dest_id = ENT_VALUE_TO_ID(dest_value);
+        uint32_t handle = dest_map_get(rel_table, dest_id);
+        if (handle == DEST_MAP_NONE) {
+            /*
+             * If we're here, origin_ent is the first entity
+             * to be in rel_name with dest_ent, so we create
+             * a new edge_set and insert into the map for
+             * rel_name
+             * */
+            handle = edge_set_pool_new(&engine->sets, INITIAL_EDGE_SET_SIZE);
+            dest_map_insert(rel_table, dest_id, handle);
+        }
+        struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+        /*
+         * We insert the id of origin_ent in the set for dest_ent
+         * */
+        size_t old_count = dest_set->count;
+        int ret = edge_set_insert(dest_set, ENT_VALUE_TO_ID(origin_value));
+        if (!ret) {
+            snapshot->op_seq++;
+            if (version_log_active(engine->versions)) {
+                version_log_record(engine->versions, snapshot->op_seq, 1, rel_name, dest_ent, origin_ent);
+            }
+        }
+        struct report_cache *cache_entry = ht_get(cache, rel_name);
+        if (cache_entry != NULL && !ret) {
+            if (dest_set->count == cache_entry->count && old_count < dest_set->count) {
+                u32_vec_push(&cache_entry->ents, dest_id);
+                cache_entry->changed_seq = snapshot->op_seq;
+            } else if (dest_set->count > cache_entry->count) {
+                u32_vec_clear(&cache_entry->ents);
+                u32_vec_push(&cache_entry->ents, dest_id);
+                cache_entry->count = dest_set->count;
+                cache_entry->changed_seq = snapshot->op_seq;
+            }
+        }
+    }
+}
+
+void del_ent(struct engine *engine, char *entity_name) {
+    struct hash_table *mon_ent = engine->mon_ent, *mon_rel = engine->mon_rel, *cache = engine->cache;
+    struct str_arr *mon_ent_list = engine->mon_ent_list, *mon_rel_list = engine->mon_rel_list;
+    struct report_snapshot *snapshot = engine->snapshot;
+    engine_flush(engine);
+    if (engine->wal != NULL) {
+        wal_append(engine->wal, CMD_DEL_ENT, entity_name, NULL, NULL);
+    }
+    /*
+     * Check if entity_name is currently monitored and remove it
+     * */
+    void *value = ht_get(mon_ent, entity_name);
+    if (value != NULL) {
+        uint32_t id = ENT_VALUE_TO_ID(value);
+        art_delete(&engine->ent_index, entity_name);
+        order_remove(&engine->ent_order, id);
+        ht_delete(mon_ent, entity_name);
+        uint32_t pos = engine->ent_pos[id];
+        ent_id_free(engine, id);
+        snapshot->op_seq++;
+        str_arr_remove_at(mon_ent_list, pos);
+        if (pos < mon_ent_list->next_free) {
+            engine->ent_pos[ENT_VALUE_TO_ID(ht_get(mon_ent, str_arr_get(mon_ent_list, pos)))] = pos;
+        }
+        struct dest_map *rel_table;
+        struct rel_vec rels_to_remove;
+        struct u32_vec dests_to_remove;
+        rel_vec_init(&rels_to_remove, INITIAL_VEC_SIZE);
+        u32_vec_init(&dests_to_remove, INITIAL_VEC_SIZE);
+        /*
+        * Delete entity_name from all relationships
+        * */
+        for (unsigned long int i = 0; i < mon_rel_list->next_free; i++) {
+            char *cur_rel = str_arr_get(mon_rel_list, i);
+            rel_table = ht_get(mon_rel, cur_rel);
+            /*
+             * Delete all relationships towards entity_name
+             * */
+            uint32_t handle = dest_map_get(rel_table, id);
+            if (handle != DEST_MAP_NONE) {
+                struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+                if (version_log_active(engine->versions)) {
+                    size_t pos = 0;
+                    uint32_t origin_id;
+                    while (edge_set_next(dest_set, &pos, &origin_id)) {
+                        /*
+                         * id has just been given up, so its name is gone
+                         * */
+                        version_log_record(engine->versions, snapshot->op_seq, 0, cur_rel, entity_name,
+                                           origin_id == id ? entity_name : engine->ent_names[origin_id]);
+                    }
+                }
+                edge_set_pool_delete(&engine->sets, handle);
+                dest_map_delete(rel_table, id);
+                struct report_cache *cache_entry = ht_get(cache, cur_rel);
+                if (cache_entry != NULL) {
+                    report_cache_destroy(cache_entry);
+                    ht_delete(cache, cur_rel);
+                }
+            }
+            /*
+             * Delete all relationships from entity_name: emptied
+             * destinations are removed after the scan, since deleting
+             * from a dest_map can move the ones not visited yet
+             * */
+            size_t dest_pos = 0;
+            uint32_t dest;
+            while (dest_map_next(rel_table, &dest_pos, &dest, &handle)) {
+                struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+                if (edge_set_delete(dest_set, id)) {
+                    if (version_log_active(engine->versions)) {
+                        version_log_record(engine->versions, snapshot->op_seq, 0, cur_rel,
+                                           engine->ent_names[dest], entity_name);
+                    }
+                    struct report_cache *cache_entry = ht_get(cache, cur_rel);
+                    if (cache_entry != NULL) {
+                        report_cache_destroy(cache_entry);
+                        ht_delete(cache, cur_rel);
+                    }
+                    if (dest_set->count == 0) {
+                        edge_set_pool_delete(&engine->sets, handle);
+                        u32_vec_push(&dests_to_remove, dest);
+                    }
+                }
+            }
+            for (size_t idx = 0; idx < dests_to_remove.len; idx++) {
+                dest_map_delete(rel_table, dests_to_remove.items[idx]);
+            }
+            u32_vec_clear(&dests_to_remove);
+            /*
+             * If the relationship map is now empty,
+             * mark it for removal from monitored relationships
+             * */
+            if (rel_table->count == 0) {
+                rel_vec_push(&rels_to_remove, rel_table);
+            }
+        }
+
+        /*
+         * Remove all relationships marked for removal
+         * */
+        for (size_t idx = 0; idx < rels_to_remove.len; idx++) {
+            rel_table = rels_to_remove.items[idx];
+            ht_delete(mon_rel, str_arr_get(mon_rel_list, rel_table->list_pos));
+            rel_list_remove(engine, rel_table);
+            dest_map_destroy(rel_table);
+        }
+        u32_vec_destroy(&dests_to_remove);
+        rel_vec_destroy(&rels_to_remove);
+    }
+}
+
+void del_rel(struct engine *engine, char *origin_ent, char *dest_ent, char *rel_name) {
+    struct hash_table *mon_rel = engine->mon_rel, *cache = engine->cache;
+    struct report_snapshot *snapshot = engine->snapshot;
+    if (engine->wal != NULL) {
+        wal_append(engine->wal, CMD_DEL_REL, origin_ent, dest_ent, rel_name);
+    }
+    struct dest_map *rel_table = ht_get(mon_rel, rel_name);
+    /*
+     * Check if rel_name is in mon_rel
+     * */
+    if (rel_table != NULL) {
+        /*
+         * Check if there's any "arrow" going to dest_ent
+         * (an entity that isn't monitored can't be either end of one)
+         * */
+        void *origin_value = ent_get(engine, origin_ent);
+        void *dest_value = ent_get(engine, dest_ent);
+        uint32_t dest_id = dest_value != NULL ? ENT_VALUE_TO_ID(dest_value) : DEST_MAP_NONE;
+        uint32_t handle = dest_value != NULL ? dest_map_get(rel_table, dest_id) : DEST_MAP_NONE;
+        if (handle != DEST_MAP_NONE && origin_value != NULL) {
+            struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+            /*
+             * If there's an "arrow" from origin_ent
+             * to dest_ent, delete it
+             * */
+
+            int ret = edge_set_delete(dest_set, ENT_VALUE_TO_ID(origin_value));
+            if (ret) {
+                snapshot->op_seq++;
+                if (version_log_active(engine->versions)) {
+                    version_log_record(engine->versions, snapshot->op_seq, 0, rel_name, dest_ent, origin_ent);
+                }
+                struct report_cache *cache_entry = ht_get(cache, rel_name);
+                if (cache_entry != NULL) {
+                    if (dest_set->count == cache_entry->count - 1) {
+                        u32_vec_remove(&cache_entry->ents, dest_id);
+                        cache_entry->changed_seq = snapshot->op_seq;
+                        if (cache_entry->ents.len == 0) {
+                            report_cache_destroy(cache_entry);
+                            ht_delete(cache, rel_name);
+                            cache_entry = NULL;
+                        }
+                    }
+                }
+                /*
+                 * If there's no other "arrow" going to dest_ent,
+                 * remove it from rel_table
+                 * */
+                if (dest_set->count == 0) {
+                    edge_set_pool_delete(&engine->sets, handle);
+                    dest_map_delete(rel_table, dest_id);
+                    /*
+                     * If rel_table is now empty (there was just that one "arrow"),
+                     * delete it and remove rel_name from mon_rel
+                     * */
+                    if (rel_table->count == 0) {
+                        rel_list_remove(engine, rel_table);
+                        dest_map_destroy(rel_table);
+                        ht_delete(mon_rel, rel_name);
+                        if (cache_entry != NULL) {
+                            report_cache_destroy(cache_entry);
+                            ht_delete(cache, rel_name);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Makes room for at least size entities in best_ents (the entities to
+ * sort and as many again for order_sort)
+ * */
+static void best_ents_reserve(struct engine *engine, size_t size) {
+    if (size <= engine->best_ents_size) {
+        return;
+    }
+    while (engine->best_ents_size < size) {
+        engine->best_ents_size *= BEST_ENTS_GROWTH_FACTOR;
+    }
+    engine->best_ents = realloc(engine->best_ents, sizeof(struct order_item) * engine->best_ents_size);
+    if (engine->best_ents == NULL) {
+        exit(666);
+    }
+}
+
+/*
+ * Rebuilds the text of the report into snapshot, from which it's then
+ * copied into a published version
+ * */
+static void report_render(struct engine *engine) {
+    struct hash_table *mon_rel = engine->mon_rel, *cache = engine->cache;
+    struct str_arr *mon_rel_list = engine->mon_rel_list;
+    struct report_snapshot *snapshot = engine->snapshot;
+    snapshot->len = 0;
+    if (mon_rel_list->next_free == 0) {
+        report_snapshot_append(snapshot, "none\n", 5);
+    } else {
+        /*
+         * Sort mon_rel_list in ascending alphabetical order (if it
+         * isn't already), keeping track of where every relationship went
+         * */
+        if (str_arr_sort(mon_rel_list)) {
+            for (unsigned long int j = 0; j < mon_rel_list->next_free; j++) {
+                struct dest_map *rel_table = ht_get(mon_rel, str_arr_get(mon_rel_list, j));
+                rel_table->list_pos = j;
+            }
+        }
+
+        /*
+         * Iterate on the now ordered array of all
+         * monitored relationships
+         * */
+        int printed = 0;
+        for (unsigned long int j = 0; j < mon_rel_list->next_free; j++) {
+            char *cur_rel = str_arr_get(mon_rel_list, j);
+            struct report_cache *cache_entry = ht_get(cache, cur_rel);
+            if (cache_entry != NULL) {
+                /*
+                 * Render the text for cur_rel again only if its
+                 * cache entry changed since it was last rendered
+                 * */
+                if (cache_entry->text != NULL && cache_entry->rendered_seq >= cache_entry->changed_seq) {
+                    report_snapshot_append(snapshot, cache_entry->text, cache_entry->text_len);
+                } else {
+                    size_t start = snapshot->len;
+                    size_t len = cache_entry->ents.len;
+                    best_ents_reserve(engine, len * 2);
+                    for (size_t i = 0; i < len; i++) {
+                        uint32_t id = cache_entry->ents.items[i];
+                        engine->best_ents[i].id = id;
+                        engine->best_ents[i].rank = order_rank(&engine->ent_order, id);
+                    }
+                    order_sort(engine->best_ents, len, engine->best_ents + len);
+                    report_snapshot_append_quoted(snapshot, cur_rel);
+                    for (size_t i = 0; i < len; i++) {
+                        report_snapshot_append_quoted(snapshot, engine->ent_names[engine->best_ents[i].id]);
+                    }
+                    report_snapshot_append_count(snapshot, cache_entry->count);
+                    report_snapshot_append(snapshot, ";", 1);
+                    report_cache_set_text(cache_entry, snapshot->buf + start, snapshot->len - start,
+                                          snapshot->op_seq);
+                }
+                if (j + 1 < mon_rel_list->next_free) {
+                    report_snapshot_append(snapshot, " ", 1);
+                }
+                printed = 1;
+                continue;
+            }
+            /*
+             * best_ents_arr will hold the entities with the most
+             * incoming "arrows" for rels[j]: it's kept by the engine
+             * and reused, growing as needed
+             * */
+            struct order_item *best_ents_arr = engine->best_ents;
+            size_t best_ents_arr_len = 0;
+            unsigned long int count = 0;
+            struct dest_map *rel_table = ht_get(mon_rel, cur_rel);
+            size_t dest_pos = 0;
+            uint32_t dest, handle;
+            while (dest_map_next(rel_table, &dest_pos, &dest, &handle)) {
+                struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+                if (dest_set->count >= count) {
+                    if (dest_set->count > count) {
+                        best_ents_arr_len = 0;
+                        count = dest_set->count;
+                    }
+                    if (best_ents_arr_len == engine->best_ents_size) {
+                        best_ents_reserve(engine, best_ents_arr_len + 1);
+                        best_ents_arr = engine->best_ents;
+                    }
+                    best_ents_arr[best_ents_arr_len].id = dest;
+                    best_ents_arr_len++;
+
+                }
+            }
+            if (count > 0) {
+                printed = 1;
+                /*
+                 * Sort best_ents_arr in ascending alphabetical order,
+                 * which is the one of the ranks in ent_order
+                 */
+                best_ents_reserve(engine, best_ents_arr_len * 2);
+                best_ents_arr = engine->best_ents;
+                for (size_t i = 0; i < best_ents_arr_len; i++) {
+                    best_ents_arr[i].rank = order_rank(&engine->ent_order, best_ents_arr[i].id);
+                }
+                order_sort(best_ents_arr, best_ents_arr_len, best_ents_arr + best_ents_arr_len);
+                cache_entry = report_cache_new(best_ents_arr_len);
+                size_t start = snapshot->len;
+                report_snapshot_append_quoted(snapshot, cur_rel);
+                for (size_t i = 0; i < best_ents_arr_len; i++) {
+                    report_snapshot_append_quoted(snapshot, engine->ent_names[best_ents_arr[i].id]);
+                    u32_vec_push(&cache_entry->ents, best_ents_arr[i].id);
+                }
+                report_snapshot_append_count(snapshot, count);
+                report_snapshot_append(snapshot, ";", 1);
+                cache_entry->count = count;
+                report_cache_set_text(cache_entry, snapshot->buf + start, snapshot->len - start,
+                                      snapshot->op_seq);
+                ht_insert(cache, cur_rel, cache_entry);
+                if (j + 1 < mon_rel_list->next_free) {
+                    report_snapshot_append(snapshot, " ", 1);
+                }
+            }
+        }
+        if (printed) {
+            report_snapshot_append(snapshot, "\n", 1);
+        } else {
+            snapshot->len = 0;
+            report_snapshot_append(snapshot, "none\n", 5);
+        }
+    }
+    snapshot->rendered_seq = snapshot->op_seq;
+}
+
+/*
+ * Brings the report published to the readers of reports up to date:
+ * held back commands are applied first, and a new version is only
+ * rendered and published if a relationship changed since the last one
+ * */
+void engine_publish_report(struct engine *engine) {
+    struct report_snapshot *snapshot = engine->snapshot;
+    engine_flush(engine);
+    if (engine->wal != NULL) {
+        wal_commit(engine->wal, 1);
+    }
+    if (snapshot->rendered_seq != snapshot->op_seq) {
+        report_render(engine);
+    }
+    struct report_version *latest = report_rcu_latest(&engine->reports);
+    if (latest == NULL || latest->seq != snapshot->rendered_seq) {
+        report_rcu_publish(&engine->reports, snapshot->rendered_seq, snapshot->buf, snapshot->len);
+    }
+}
+
+/*
+ * Returns the text of the report (len is set to its length), which is
+ * the latest published version: it stays valid until the next command
+ * that changes a relationship
+ * */
+const char *report(struct engine *engine, size_t *len) {
+    engine_publish_report(engine);
+    struct report_version *latest = report_rcu_latest(&engine->reports);
+    *len = latest->len;
+    return latest->text;
+}
+
+void report_write(struct engine *engine, FILE *out) {
+    size_t len;
+    const char *text = report(engine, &len);
+    fwrite(text, sizeof(char), len, out);
+}
+
+/*
+ * Opens a read view of the current state and returns its sequence
+ * number, to be passed to origins and then to engine_read_end.
+ * Held back commands are applied first: they were sent before the
+ * view was opened, so it has to see them
+ * */
+unsigned long long int engine_read_begin(struct engine *engine) {
+    engine_flush(engine);
+    version_log_open(engine->versions, engine->snapshot->op_seq);
+    return engine->snapshot->op_seq;
+}
+
+void engine_read_end(struct engine *engine, unsigned long long int seq) {
+    version_log_close(engine->versions, seq);
+}
+
+static const int VERSION_PRESENT = 1, VERSION_ABSENT = 0;
+
+/*
+ * Returns the origins of the "arrows" going to dest_ent in rel_name
+ * as they were at seq, the sequence number of an open read view (or
+ * READ_LATEST), in ascending alphabetical order: len is set to
+ * the length of the text, which stays valid until the next query.
+ * The first change after seq to an "arrow" tells whether it was there
+ * at seq: if it was added, it wasn't; if it was deleted, it was.
+ * The "arrows" not changed since are read from the current state
+ * */
+const char *origins(struct engine *engine, unsigned long long int seq, char *dest_ent, char *rel_name,
+                    size_t *len) {
+    struct version_log *log = engine->versions;
+    struct report_snapshot *query = engine->query;
+    engine_flush(engine);
+    if (engine->wal != NULL) {
+        wal_commit(engine->wal, 1);
+    }
+    struct hash_table *changed = engine->query_changed;
+    struct din_arr *names = engine->query_names;
+    for (size_t i = log->start; i < log->end; i++) {
+        struct version_record *record = &log->records[i];
+        if (record->seq > seq && strcmp(version_record_rel(record), rel_name) == 0 &&
+            strcmp(version_record_dest(record), dest_ent) == 0) {
+            char *origin = (char *) version_record_origin(record);
+            if (ht_get(changed, origin) == NULL) {
+                ht_insert(changed, origin, (void *) (record->added ? &VERSION_ABSENT : &VERSION_PRESENT));
+            }
+        }
+    }
+
+    struct dest_map *rel_table = ht_get(engine->mon_rel, rel_name);
+    void *dest_value = ht_get(engine->mon_ent, dest_ent);
+    uint32_t handle = rel_table != NULL && dest_value != NULL ?
+                      dest_map_get(rel_table, ENT_VALUE_TO_ID(dest_value)) : DEST_MAP_NONE;
+    if (handle != DEST_MAP_NONE) {
+        struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+        size_t pos = 0;
+        uint32_t origin_id;
+        while (edge_set_next(dest_set, &pos, &origin_id)) {
+            if (ht_get(changed, engine->ent_names[origin_id]) == NULL) {
+                din_arr_push(names, engine->ent_names[origin_id]);
+            }
+        }
+    }
+    unsigned long int changed_pos = 0;
+    struct ht_item *item;
+    while (ht_next(changed, &changed_pos, &item)) {
+        if (item->value == &VERSION_PRESENT) {
+            din_arr_push(names, item->key);
+        }
+    }
+
+    query->len = 0;
+    if (names->next_free == 0) {
+        report_snapshot_append(query, "none\n", 5);
+    } else {
+        din_arr_sort_strings(names);
+        for (unsigned long int i = 0; i < names->next_free; i++) {
+            report_snapshot_append_quoted(query, names->array[i]);
+        }
+        /*
+         * Replace the space after the last name
+         * */
+        query->buf[query->len - 1] = '\n';
+    }
+    din_arr_soft_clear(names);
+    ht_soft_clear(changed);
+    *len = query->len;
+    return query->buf;
+}
+
+static void list_ent_append(struct ht_item *item, void *data) {
+    report_snapshot_append_quoted(data, item->key);
+}
+
+/*
+ * Returns the monitored entities whose name starts with prefix, in
+ * ascending alphabetical order: len is set to the length of the text,
+ * which stays valid until the next query. Entities aren't versioned,
+ * so it always sees the current ones, read view or not
+ * */
+const char *list_ent(struct engine *engine, const char *prefix, size_t *len) {
+    struct report_snapshot *query = engine->query;
+    if (engine->wal != NULL) {
+        wal_commit(engine->wal, 1);
+    }
+    query->len = 0;
+    art_prefix_each(&engine->ent_index, prefix, list_ent_append, query);
+    if (query->len == 0) {
+        report_snapshot_append(query, "none\n", 5);
+    } else {
+        /*
+         * Replace the space after the last name
+         * */
+        query->buf[query->len - 1] = '\n';
+    }
+    *len = query->len;
+    return query->buf;
+}
+
+void run_command(struct engine *engine, struct command *command, FILE *out) {
+    switch (command->action) {
+        case CMD_ADD_ENT:
+            add_ent(engine, command->params[0]);
+            break;
+        case CMD_DEL_ENT:
+            del_ent(engine, command->params[0]);
+            break;
+        case CMD_ADD_REL:
+        case CMD_DEL_REL:
+            if (engine->batch != NULL) {
+                batch_rel(engine, command->action, command->params[0], command->params[1], command->params[2]);
+            } else if (command->action == CMD_ADD_REL) {
+                add_rel(engine, command->params[0], command->params[1], command->params[2]);
+            } else {
+                del_rel(engine, command->params[0], command->params[1], command->params[2]);
+            }
+            break;
+        case CMD_REPORT:
+            report_write(engine, out);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Once the batch is done, the report is published again if any
+ * reader is registered to read it
+ * */
+void run_commands(struct engine *engine, struct command *commands, size_t n, FILE *out) {
+    for (size_t i = 0; i < n; i++) {
+        run_command(engine, &commands[i], out);
+    }
+    if (report_rcu_has_readers(&engine->reports)) {
+        engine_publish_report(engine);
+    }
+}
+
+struct engine *engine_new(void) {
+    struct engine *engine = malloc(sizeof(struct engine));
+    if (engine == NULL) {
+        exit(666);
+    }
+    engine->mon_ent = ht_new(INITIAL_MON_ENT_SIZE);
+    art_init(&engine->ent_index);
+    order_init(&engine->ent_order);
+    bloom_init(&engine->ent_filter, INITIAL_BLOOM_CAPACITY);
+    engine->mon_rel = ht_new(INITIAL_MON_REL_SIZE);
+    engine->cache = ht_new(INITIAL_MON_REL_SIZE);
+    engine->mon_ent_list = str_arr_new(INITIAL_MON_ENT_SIZE);
+    engine->mon_rel_list = str_arr_new(INITIAL_MON_REL_SIZE);
+    engine->ent_ids_size = INITIAL_ENT_IDS_SIZE;
+    engine->ent_names = malloc(sizeof(char *) * engine->ent_ids_size);
+    engine->ent_pos = malloc(sizeof(uint32_t) * engine->ent_ids_size);
+    if (engine->ent_names == NULL || engine->ent_pos == NULL) {
+        exit(666);
+    }
+    u32_vec_init(&engine->free_ids, INITIAL_VEC_SIZE);
+    engine->next_ent_id = 0;
+    engine->best_ents_size = INITIAL_BEST_ENTS_SIZE;
+    engine->best_ents = malloc(sizeof(struct order_item) * engine->best_ents_size);
+    if (engine->best_ents == NULL) {
+        exit(666);
+    }
+    engine->snapshot = report_snapshot_new(INITIAL_SNAPSHOT_SIZE);
+    engine->query = report_snapshot_new(INITIAL_SNAPSHOT_SIZE);
+    report_rcu_init(&engine->reports);
+    engine->query_changed = ht_new(INITIAL_HASH_TABLE_SIZE);
+    engine->query_names = din_arr_new(INITIAL_DA_SIZE);
+    edge_set_pool_init(&engine->sets, INITIAL_EDGE_SET_POOL_SIZE);
+    engine->versions = version_log_new();
+    engine->batch = NULL;
+    engine->wal = NULL;
+    engine->generation = 0;
+    engine->checkpoint_map = NULL;
+    engine->checkpoint_map_len = 0;
+    return engine;
+}
+
+void engine_destroy(struct engine *engine) {
+    engine_set_coalescing(engine, 0);
+    for (unsigned long int j = 0; j < engine->mon_rel_list->next_free; j++) {
+        char *cur_rel = str_arr_get(engine->mon_rel_list, j);
+        struct dest_map *rel_table = ht_get(engine->mon_rel, cur_rel);
+        size_t dest_pos = 0;
+        uint32_t dest, handle;
+        while (dest_map_next(rel_table, &dest_pos, &dest, &handle)) {
+            edge_set_pool_delete(&engine->sets, handle);
+        }
+        dest_map_destroy(rel_table);
+        struct report_cache *cache_entry = ht_get(engine->cache, cur_rel);
+        if (cache_entry != NULL) {
+            report_cache_destroy(cache_entry);
+        }
+    }
+    ht_soft_destroy(engine->mon_rel);
+    ht_soft_destroy(engine->cache);
+    art_destroy(&engine->ent_index);
+    order_destroy(&engine->ent_order);
+    bloom_destroy(&engine->ent_filter);
+    ht_soft_destroy(engine->mon_ent);
+    str_arr_destroy(engine->mon_ent_list);
+    str_arr_destroy(engine->mon_rel_list);
+    slab_heap_free(engine->ent_names);
+    slab_heap_free(engine->ent_pos);
+    u32_vec_destroy(&engine->free_ids);
+    free(engine->best_ents);
+    report_snapshot_destroy(engine->snapshot);
+    report_snapshot_destroy(engine->query);
+    report_rcu_destroy(&engine->reports);
+    ht_soft_destroy(engine->query_changed);
+    din_arr_soft_destroy(engine->query_names);
+    edge_set_pool_destroy(&engine->sets);
+    version_log_destroy(engine->versions);
+    if (engine->wal != NULL) {
+        wal_close(engine->wal);
+    }
+    checkpoint_unmap(engine);
+    free(engine);
+}
@@ -0,0 +1,228 @@
+#ifndef PROVAFINALEAPI_ENGINE_H
+#define PROVAFINALEAPI_ENGINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include "din_arr.h"
+#include "hash_table.h"
+#include "art.h"
+#include "bloom.h"
+#include "str_arr.h"
+#include "edge_set.h"
+#include "dest_map.h"
+#include "order.h"
+#include "report_rcu.h"
+#include "version_log.h"
+#include "vec.h"
+
+#define INITIAL_MON_REL_SIZE 512
+#define INITIAL_MON_ENT_SIZE 131072
+#define INITIAL_ENT_IDS_SIZE 1024
+#define ENT_IDS_GROWTH_FACTOR 2
+#define INITIAL_EDGE_SET_POOL_SIZE 1024
+
+#define INITIAL_BEST_ENTS_SIZE 1024
+#define BEST_ENTS_GROWTH_FACTOR 2
+
+#define MAX_BATCH_COMMANDS 4096
+#define BATCH_NAMES_SIZE 262144
+
+#define INITIAL_SNAPSHOT_SIZE 4096
+#define SNAPSHOT_GROWTH_FACTOR 2
+
+#define CMD_ADD_ENT 1
+#define CMD_DEL_ENT 2
+#define CMD_ADD_REL 3
+#define CMD_DEL_REL 4
+#define CMD_REPORT 5
+
+/*
+ * Sequence number for origins queries outside of a read view
+ * */
+#define READ_LATEST ULLONG_MAX
+
+/*
+ * Entity ids are stored right in the values of mon_ent, shifted by
+ * one so that a monitored entity never has a NULL value
+ * */
+#define ENT_ID_TO_VALUE(id) ((void *) (uintptr_t) ((id) + 1))
+#define ENT_VALUE_TO_ID(value) ((uint32_t) ((uintptr_t) (value) - 1))
+
+/*
+ * changed_seq is the operation sequence number of the last change
+ * to ents, rendered_seq the one at which text was last rendered:
+ * text can be reused as long as rendered_seq >= changed_seq.
+ * ents holds the ids of the destinations with count "arrows" (an
+ * entity is dropped from every cache entry before its id is given
+ * to another one)
+ * */
+struct report_cache {
+    struct u32_vec ents;
+    size_t count;
+    char *text;
+    size_t text_len;
+    unsigned long long int changed_seq;
+    unsigned long long int rendered_seq;
+};
+
+/*
+ * Holds the full text of the last report: op_seq is bumped by every
+ * command that changes a relationship, so while rendered_seq == op_seq
+ * a report can just write it out again.
+ * Only the engine reads and writes it: what readers see is the copy
+ * published in reports
+ * */
+struct report_snapshot {
+    char *buf;
+    size_t len;
+    size_t size;
+    unsigned long long int op_seq;
+    unsigned long long int rendered_seq;
+};
+
+/*
+ * The whole monitored state: entities, relationships (each one a
+ * dest_map from destination ids to the handles, in sets, of the
+ * edge_set of their origins) and the report caches. generation and
+ * wal are only used by persistence.c, batch is NULL unless coalescing
+ * is enabled.
+ * mon_ent maps every entity to its id, and ent_names maps ids back to
+ * the keys of mon_ent (which never move, unlike the strings of
+ * mon_ent_list); ent_index holds the items of mon_ent in alphabetical
+ * order, for list_ent, and ent_order keeps their ids in the same
+ * order, with ranks that report sorts instead of the names. The ids
+ * of deleted entities are kept in free_ids and given out again first,
+ * so ids stay small. ent_filter is a Bloom filter of the names in
+ * mon_ent, which turns away addrel and delrel commands naming entities
+ * that aren't monitored without probing mon_ent.
+ * ent_pos maps ids to positions in mon_ent_list (and the list_pos of
+ * every relationship is its position in mon_rel_list), so that
+ * removing a name from a list doesn't have to look for it.
+ * best_ents is scratch space for report, kept to avoid allocating
+ * it (or putting it on the stack) on every report, and reports holds
+ * the last rendered report as an immutable version that other threads
+ * can read while the engine goes on applying commands.
+ * versions holds the open read views and what they need to see the
+ * "arrows" as they were when they were opened, query the text of the
+ * last origins or list_ent query, with query_changed and query_names
+ * as its scratch space.
+ * checkpoint_map is the checkpoint the state was loaded from (NULL if
+ * none): its tables are used right in the mapping, which stays until
+ * the engine is destroyed
+ * */
+struct engine {
+    struct hash_table *mon_ent;
+    struct art ent_index;
+    struct order ent_order;
+    struct bloom ent_filter;
+    struct hash_table *mon_rel;
+    struct hash_table *cache;
+    struct str_arr *mon_ent_list;
+    struct str_arr *mon_rel_list;
+    char **ent_names;
+    uint32_t *ent_pos;
+    struct u32_vec free_ids;
+    size_t ent_ids_size;
+    uint32_t next_ent_id;
+    struct edge_set_pool sets;
+    struct order_item *best_ents;
+    size_t best_ents_size;
+    struct report_snapshot *snapshot;
+    struct report_rcu reports;
+    struct report_snapshot *query;
+    struct hash_table *query_changed;
+    struct din_arr *query_names;
+    struct version_log *versions;
+    struct command_batch *batch;
+    struct wal *wal;
+    uint32_t generation;
+    void *checkpoint_map;
+    size_t checkpoint_map_len;
+};
+
+/*
+ * A pre-parsed command: params holds the entity for CMD_ADD_ENT and
+ * CMD_DEL_ENT, origin, destination and relationship for CMD_ADD_REL and
+ * CMD_DEL_REL, and nothing for CMD_REPORT
+ * */
+struct command {
+    int action;
+    char *params[3];
+};
+
+/*
+ * The addrel and delrel commands held back since the last report or
+ * delent, in order: their names are copied one after the other into
+ * names, which never moves, so a later command always has its names
+ * at higher addresses
+ * */
+struct command_batch {
+    struct command *commands;
+    size_t count;
+    char *names;
+    size_t names_len;
+};
+
+struct report_cache *report_cache_new(size_t size);
+
+void report_cache_set_text(struct report_cache *cache, const char *text, size_t len,
+                           unsigned long long int seq);
+
+void report_cache_destroy(struct report_cache *cache);
+
+struct report_snapshot *report_snapshot_new(size_t initial_size);
+
+void report_snapshot_append(struct report_snapshot *snapshot, const char *str, size_t len);
+
+void report_snapshot_append_quoted(struct report_snapshot *snapshot, const char *name);
+
+void report_snapshot_append_count(struct report_snapshot *snapshot, unsigned long int count);
+
+void report_snapshot_destroy(struct report_snapshot *snapshot);
+
+struct command_batch *command_batch_new(void);
+
+void command_batch_destroy(struct command_batch *batch);
+
+struct engine *engine_new(void);
+
+void engine_destroy(struct engine *engine);
+
+void engine_set_coalescing(struct engine *engine, int enabled);
+
+void engine_flush(struct engine *engine);
+
+void add_ent(struct engine *engine, char *entity_name);
+
+void add_rel(struct engine *engine, char *origin_ent, char *dest_ent, char *rel_name);
+
+void del_ent(struct engine *engine, char *entity_name);
+
+void del_rel(struct engine *engine, char *origin_ent, char *dest_ent, char *rel_name);
+
+void engine_publish_report(struct engine *engine);
+
+const char *report(struct engine *engine, size_t *len);
+
+unsigned long long int engine_read_begin(struct engine *engine);
+
+void engine_read_end(struct engine *engine, unsigned long long int seq);
+
+const char *origins(struct engine *engine, unsigned long long int seq, char *dest_ent, char *rel_name,
+                    size_t *len);
+
+const char *list_ent(struct engine *engine, const char *prefix, size_t *len);
+
+void report_write(struct engine *engine, FILE *out);
+
+/*
+ * Runs commands in order, writing reports to out: with coalescing
+ * enabled, addrel and delrel are held back until the next report or
+ * delent and only their net effect is applied
+ * */
+void run_command(struct engine *engine, struct command *command, FILE *out);
+
+void run_commands(struct engine *engine, struct command *commands, size_t n, FILE *out);
+
+#endif //PROVAFINALEAPI_ENGINE_H
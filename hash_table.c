@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//#include "xxhash.h"
+#include "hash_table.h"
+#include "slab.h"
+
+const int dummy = 1;
+
+static unsigned long inline
+djb2(unsigned char *str) {
+    unsigned long hash = 5381;
+    int c;
+
+    while ((c = *str++))
+        hash = ((hash << 5) + hash) + c; /* djb2 * 33 + c */
+
+    return hash;
+}
+
+static unsigned long inline
+sdbm(str)
+        unsigned char *str;
+{
+    unsigned long hash = 0;
+    int c;
+
+    while ((c = *str++))
+        hash = c + (hash << 6) + (hash << 16) - hash;
+
+    return hash;
+}
+
+static unsigned long long inline calcul_hash(const void *buffer) {
+    return djb2(buffer);
+}
+
+
+/*
+ * Items and their keys are a single slab block
+ * */
+void ht_item_destroy(struct ht_item *item) {
+    slab_free(item, sizeof(struct ht_item) + strlen(item->key) + 1);
+}
+
+void ht_init(struct hash_table *ht, unsigned long int initial_size) {
+    ht->index = malloc(sizeof(int32_t) * initial_size);
+    ht->entries_size = initial_size * HT_RESIZE_THRESHOLD_PERCENTAGE / 100 + 1;
+    ht->entries = malloc(sizeof(struct ht_entry) * ht->entries_size);
+    if (ht->index == NULL || ht->entries == NULL) {
+        exit(666);
+    }
+    memset(ht->index, 0xff, sizeof(int32_t) * initial_size);
+    ht->size = initial_size;
+    ht->count = 0u;
+    ht->used = 0u;
+    ht->filled = 0u;
+}
+
+struct hash_table *ht_new(unsigned long int initial_size) {
+    struct hash_table *ht = slab_alloc(sizeof(struct hash_table));
+    ht_init(ht, initial_size);
+    return ht;
+}
+
+/*
+ * Returns the slot of index holding key, or -1 if it's not there.
+ * If free_slot is not NULL, it's set to the first slot key could go in:
+ * a deleted one met along the way, or the empty one that ended the probe.
+ * Slots are probed with double hashing first, and then linearly
+ * (there's always an empty slot, since the table is rebuilt well
+ * before it fills up)
+ * */
+static long int ht_lookup(struct hash_table *ht, char *key, unsigned long long int hash, long int *free_slot) {
+    unsigned long int mask = ht->size - 1;
+    unsigned long int max_double_hashing_rounds = ht->size / DOUBLE_HASHING_FACTOR;
+    unsigned long long int step = 0;
+    unsigned long int index = hash & mask;
+    long int first_free = -1;
+    unsigned long int i = 1;
+    for (unsigned long int probes = 0; probes < max_double_hashing_rounds + ht->size; probes++) {
+        int32_t slot = ht->index[index];
+        if (slot == HT_EMPTY_SLOT) {
+            if (first_free < 0) {
+                first_free = (long int) index;
+            }
+            break;
+        }
+        if (slot == HT_DELETED_SLOT) {
+            if (first_free < 0) {
+                first_free = (long int) index;
+            }
+        } else if (ht->entries[slot].hash == hash && strcmp(ht->entries[slot].item->key, key) == 0) {
+            return (long int) index;
+        }
+        if (i < max_double_hashing_rounds) {
+            if (step == 0) {
+                step = sdbm((unsigned char *) key) + 1;
+            }
+            index = (hash + i * step) & mask;
+            i++;
+        } else {
+            index = (index + 1) & mask;
+        }
+    }
+    if (free_slot != NULL) {
+        *free_slot = first_free;
+    }
+    return -1;
+}
+
+/*
+ * Drops the deleted entries (keeping the others in insertion order)
+ * and builds a new index of new_size slots for them: the items
+ * themselves never move
+ * */
+static void ht_rebuild(struct hash_table *ht, unsigned long int new_size) {
+    unsigned long int used = 0;
+    for (unsigned long int i = 0; i < ht->used; i++) {
+        if (ht->entries[i].item != NULL) {
+            ht->entries[used++] = ht->entries[i];
+        }
+    }
+    ht->used = used;
+    if (new_size != ht->size) {
+        slab_heap_free(ht->index);
+        ht->index = malloc(sizeof(int32_t) * new_size);
+        if (ht->index == NULL) {
+            exit(666);
+        }
+        ht->size = new_size;
+    }
+    memset(ht->index, 0xff, sizeof(int32_t) * ht->size);
+    unsigned long int entries_size = ht->size * HT_RESIZE_THRESHOLD_PERCENTAGE / 100 + 1;
+    if (entries_size > ht->entries_size) {
+        ht->entries = slab_heap_realloc(ht->entries, sizeof(struct ht_entry) * ht->entries_size,
+                                        sizeof(struct ht_entry) * entries_size);
+        if (ht->entries == NULL) {
+            exit(666);
+        }
+        ht->entries_size = entries_size;
+    }
+    for (unsigned long int i = 0; i < ht->used; i++) {
+        long int free_slot;
+        ht_lookup(ht, ht->entries[i].item->key, ht->entries[i].hash, &free_slot);
+        ht->index[free_slot] = (int32_t) i;
+    }
+    ht->filled = ht->used;
+}
+
+void ht_rehash_in_place(struct hash_table *ht) {
+    ht_rebuild(ht, ht->size);
+}
+
+void ht_resize(struct hash_table *ht, size_t new_size) {
+    ht_rebuild(ht, new_size);
+}
+
+struct ht_item *ht_new_item(char *key, void *value) {
+    size_t key_size = strlen(key) + 1;
+    struct ht_item *item = slab_alloc(sizeof(struct ht_item) + key_size);
+    item->key = (char *) (item + 1);
+    memcpy(item->key, key, key_size);
+
+    item->value = value;
+
+    return item;
+}
+
+/*
+ * Makes room for one more entry: when entries is full, deleted entries
+ * are dropped if they are at least half of them, otherwise it grows
+ * */
+static void ht_entries_reserve(struct hash_table *ht) {
+    if (ht->used < ht->entries_size) {
+        return;
+    }
+    if (ht->count <= ht->used / 2) {
+        ht_rebuild(ht, ht->size);
+    } else {
+        ht->entries = slab_heap_realloc(ht->entries, sizeof(struct ht_entry) * ht->entries_size,
+                                        sizeof(struct ht_entry) * ht->entries_size * HT_ENTRIES_GROWTH_FACTOR);
+        ht->entries_size *= HT_ENTRIES_GROWTH_FACTOR;
+        if (ht->entries == NULL) {
+            exit(666);
+        }
+    }
+}
+
+/*
+ * Returns 0 if elem was not already in ht, 1 otherwise (replacement).
+ * Tables that don't resize must be big enough for what goes in them
+ * (see ht_size_for): they're only rebuilt, at the same size, before
+ * running out of empty slots
+ * */
+int __ht_insert(struct hash_table *ht, char *key, void *elem, short int resizing) {
+    if (ht->filled >= ht->size * HT_RESIZE_THRESHOLD_PERCENTAGE / 100 &&
+        (resizing || ht->filled + 1 >= ht->size)) {
+        /*
+         * Grow only if the live items are many enough, otherwise
+         * dropping the deleted slots makes enough room
+         * */
+        if (resizing && ht->count >= ht->size * HT_RESIZE_THRESHOLD_PERCENTAGE / 100 / 2) {
+            ht_rebuild(ht, ht->size * 2);
+        } else {
+            ht_rebuild(ht, ht->size);
+        }
+    }
+    ht_entries_reserve(ht);
+    unsigned long long int hash = calcul_hash(key);
+    long int free_slot;
+    long int slot = ht_lookup(ht, key, hash, &free_slot);
+    struct ht_item *item = ht_new_item(key, elem);
+    if (slot >= 0) {
+        /*
+         * The new item takes the entry of the one it replaces
+         * */
+        struct ht_entry *entry = &ht->entries[ht->index[slot]];
+        ht_item_destroy(entry->item);
+        entry->item = item;
+        return 1;
+    }
+    if (ht->index[free_slot] == HT_EMPTY_SLOT) {
+        ht->filled++;
+    }
+    ht->index[free_slot] = (int32_t) ht->used;
+    ht->entries[ht->used].hash = hash;
+    ht->entries[ht->used].item = item;
+    ht->used++;
+    ht->count++;
+    return 0;
+}
+
+/*
+ * Returns 0 if elem was not already in ht, 1 otherwise (replacement)
+ * */
+int ht_insert_no_resize(struct hash_table *ht, char *key, void *elem) {
+    return __ht_insert(ht, key, elem, 0);
+}
+
+/*
+ * Returns 0 if elem was not already in ht, 1 otherwise (replacement)
+ * */
+int ht_insert(struct hash_table *ht, char *key, void *elem) {
+    return __ht_insert(ht, key, elem, 1);
+}
+
+/*
+ * Returns the item holding key (its key stays where it is until
+ * the item is deleted or replaced), or NULL
+ * */
+struct ht_item *ht_get_item(struct hash_table *ht, char *key) {
+    long int slot = ht_lookup(ht, key, calcul_hash(key), NULL);
+    return slot >= 0 ? ht->entries[ht->index[slot]].item : NULL;
+}
+
+void *ht_get(struct hash_table *ht, char *key) {
+    struct ht_item *item = ht_get_item(ht, key);
+    return item != NULL ? item->value : NULL;
+}
+
+/*
+ * The hash ht uses for key, so that callers that need it as well
+ * only compute it once and pass it to ht_get_hashed
+ * */
+unsigned long long int ht_hash(char *key) {
+    return calcul_hash(key);
+}
+
+void *ht_get_hashed(struct hash_table *ht, char *key, unsigned long long int hash) {
+    long int slot = ht_lookup(ht, key, hash, NULL);
+    return slot >= 0 ? ht->entries[ht->index[slot]].item->value : NULL;
+}
+
+/*
+ * Returns 0 if no element was deleted, 1 otherwise.
+ * The entry is left empty (and dropped at the next rebuild), unless
+ * it's the last one
+ * */
+int ht_delete(struct hash_table *ht, char *key) {
+    long int slot = ht_lookup(ht, key, calcul_hash(key), NULL);
+    if (slot < 0) {
+        return 0;
+    }
+    unsigned long int pos = (unsigned long int) ht->index[slot];
+    ht_item_destroy(ht->entries[pos].item);
+    ht->entries[pos].item = NULL;
+    if (pos + 1 == ht->used) {
+        ht->used--;
+    }
+    ht->index[slot] = HT_DELETED_SLOT;
+    ht->count--;
+    return 1;
+}
+
+/*
+ * Returns the smallest power of two table size that can hold count
+ * elements without resizing, but never less than min_size
+ * */
+unsigned long int ht_size_for(size_t count, unsigned long int min_size) {
+    unsigned long int size = min_size;
+    while (count >= size * HT_RESIZE_THRESHOLD_PERCENTAGE / 100) {
+        size *= 2;
+    }
+    return size;
+}
+
+void print_keys(struct hash_table *ht) {
+    unsigned long int pos = 0;
+    struct ht_item *item;
+    printf("\n[");
+    while (ht_next(ht, &pos, &item)) {
+        printf("'%s',", item->key);
+    }
+    printf("]\n");
+}
+
+/*
+ * Deletes every item, leaving the values alone, but keeps the room
+ * the table has grown to
+ * */
+void ht_soft_clear(struct hash_table *ht) {
+    unsigned long int pos = 0;
+    struct ht_item *item;
+    while (ht_next(ht, &pos, &item)) {
+        ht_item_destroy(item);
+    }
+    memset(ht->index, 0xff, sizeof(int32_t) * ht->size);
+    ht->count = 0;
+    ht->used = 0;
+    ht->filled = 0;
+}
+
+void ht_destroy(struct hash_table *ht) {
+    unsigned long int pos = 0;
+    struct ht_item *item;
+    while (ht_next(ht, &pos, &item)) {
+        if (item->value != &dummy)
+            slab_heap_free(item->value);
+        ht_item_destroy(item);
+    }
+    slab_heap_free(ht->index);
+    slab_heap_free(ht->entries);
+    slab_free(ht, sizeof(struct hash_table));
+}
+
+/*
+ * Like ht_destroy, but leaves the values alone
+ * */
+void ht_soft_destroy(struct hash_table *ht) {
+    unsigned long int pos = 0;
+    struct ht_item *item;
+    while (ht_next(ht, &pos, &item)) {
+        ht_item_destroy(item);
+    }
+    slab_heap_free(ht->index);
+    slab_heap_free(ht->entries);
+    slab_free(ht, sizeof(struct hash_table));
+}
@@ -0,0 +1,103 @@
+#ifndef PROVAFINALEAPI_HASH_TABLE_H
+#define PROVAFINALEAPI_HASH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INITIAL_HASH_TABLE_SIZE 256
+#define HT_RESIZE_THRESHOLD_PERCENTAGE 50
+#define HT_ENTRIES_GROWTH_FACTOR 2
+
+#define DOUBLE_HASHING_FACTOR 1
+
+#define HT_EMPTY_SLOT (-1)
+#define HT_DELETED_SLOT (-2)
+
+/*
+ * Value stored in tables that are only used as sets
+ * */
+extern const int dummy;
+
+struct ht_item {
+    char *key;
+    void *value;
+};
+
+/*
+ * item is NULL once it's deleted
+ * */
+struct ht_entry {
+    unsigned long long int hash;
+    struct ht_item *item;
+};
+
+/*
+ * Compact layout: the slots of index (size of them) hold the position
+ * of an entry, HT_EMPTY_SLOT or HT_DELETED_SLOT, and entries[0, used)
+ * are the items in insertion order, deleted ones included.
+ * count is the number of live items, filled the number of slots that
+ * are not empty
+ * */
+struct hash_table {
+    int32_t *index;
+    struct ht_entry *entries;
+    unsigned long int size;
+    unsigned long int count;
+    unsigned long int used;
+    unsigned long int filled;
+    unsigned long int entries_size;
+};
+
+void ht_item_destroy(struct ht_item *item);
+
+void ht_init(struct hash_table *ht, unsigned long int initial_size);
+
+struct hash_table *ht_new(unsigned long int initial_size);
+
+void ht_rehash_in_place(struct hash_table *ht);
+
+void ht_resize(struct hash_table *ht, size_t new_size);
+
+struct ht_item *ht_new_item(char *key, void *value);
+
+int ht_insert_no_resize(struct hash_table *ht, char *key, void *elem);
+
+int ht_insert(struct hash_table *ht, char *key, void *elem);
+
+struct ht_item *ht_get_item(struct hash_table *ht, char *key);
+
+void *ht_get(struct hash_table *ht, char *key);
+
+unsigned long long int ht_hash(char *key);
+
+void *ht_get_hashed(struct hash_table *ht, char *key, unsigned long long int hash);
+
+int ht_delete(struct hash_table *ht, char *key);
+
+unsigned long int ht_size_for(size_t count, unsigned long int min_size);
+
+/*
+ * Sets item to the next live item of ht in insertion order, starting
+ * from *pos (0 for the first one). Returns 0 when there are no more.
+ * Deleting items while iterating is fine, since nothing moves, but
+ * inserting may rebuild the table
+ * */
+static inline int ht_next(struct hash_table *ht, unsigned long int *pos, struct ht_item **item) {
+    while (*pos < ht->used) {
+        *item = ht->entries[(*pos)++].item;
+        if (*item != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void print_keys(struct hash_table *ht);
+
+void ht_soft_clear(struct hash_table *ht);
+
+void ht_destroy(struct hash_table *ht);
+
+void ht_soft_destroy(struct hash_table *ht);
+
+#endif //PROVAFINALEAPI_HASH_TABLE_H
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+
+void list_init(struct list *list) {
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+}
+
+struct list_node *list_create_new_node(void *elem, size_t elem_size) {
+    struct list_node *node = malloc(sizeof(struct list_node));
+    if (node == NULL) {
+        exit(666);
+    }
+    node->prev = NULL;
+    node->next = NULL;
+    node->elem = malloc(elem_size);
+    if (node->elem == NULL) {
+        exit(666);
+    }
+    memcpy(node->elem, elem, elem_size);
+    return node;
+}
+
+struct list *list_new() {
+    struct list *ls = malloc(sizeof(struct list));
+    list_init(ls);
+    return ls;
+}
+
+void list_append(struct list *list, void *elem, size_t elem_size) {
+    struct list_node *new_node = list_create_new_node(elem, elem_size);
+    if (list->tail == NULL) {
+        list->head = new_node;
+        list->tail = new_node;
+    } else {
+        new_node->prev = list->tail;
+        list->tail->next = new_node;
+        list->tail = new_node;
+    }
+    list->length++;
+}
+
+void list_remove(struct list *list, void *elem, int (*cmp)(void *, void *)) {
+    struct list_node *cur = list->head;
+    while (cur != NULL) {
+        if (cur->elem != NULL && cmp(cur->elem, elem) == 0) {
+            if (cur == list->head) {
+                if (cur == list->tail) {
+                    list->head = NULL;
+                    list->tail = NULL;
+                    free(cur->elem);
+                    free(cur);
+                } else {
+                    list->head = cur->next;
+                    free(cur->elem);
+                    free(cur);
+                }
+            } else if (cur == list->tail) {
+                list->tail = cur->prev;
+                list->tail->next = NULL;
+                free(cur->elem);
+                free(cur);
+            } else {
+                cur->prev->next = cur->next;
+                cur->next->prev = cur->prev;
+                free(cur->elem);
+                free(cur);
+            }
+            list->length--;
+            return;
+        }
+        cur = cur->next;
+    }
+}
+
+
+void list_print(struct list *list) {
+    struct list_node *cur = list->head;
+    printf("[");
+    while (cur != NULL) {
+        if (cur->next != NULL) {
+            printf("'%s', ", (char *) cur->elem);
+        } else {
+            printf("'%s'", (char *) cur->elem);
+        }
+        cur = cur->next;
+    }
+    printf("]\n");
+}
+
+void list_destroy(struct list *list) {
+    struct list_node *cur = list->head;
+    while (cur != NULL) {
+        struct list_node *next = cur->next;
+        free(cur->elem);
+        free(cur);
+        cur = next;
+    }
+    free(list);
+}
@@ -0,0 +1,32 @@
+#ifndef PROVAFINALEAPI_LIST_H
+#define PROVAFINALEAPI_LIST_H
+
+#include <stddef.h>
+
+struct list_node {
+    struct list_node *prev;
+    struct list_node *next;
+    void *elem;
+};
+
+struct list {
+    struct list_node *head;
+    struct list_node *tail;
+    int length;
+};
+
+void list_init(struct list *list);
+
+struct list_node *list_create_new_node(void *elem, size_t elem_size);
+
+struct list *list_new();
+
+void list_append(struct list *list, void *elem, size_t elem_size);
+
+void list_remove(struct list *list, void *elem, int (*cmp)(void *, void *));
+
+void list_print(struct list *list);
+
+void list_destroy(struct list *list);
+
+#endif //PROVAFINALEAPI_LIST_H
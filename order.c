@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include "order.h"
+#include "slab.h"
+
+#define ORDER_RANK_LIMIT (UINT64_C(1) << ORDER_RANK_BITS)
+
+void order_init(struct order *order) {
+    order->size = INITIAL_ORDER_SIZE;
+    order->nodes = malloc(sizeof(struct order_node) * order->size);
+    if (order->nodes == NULL) {
+        exit(666);
+    }
+    order->first = ORDER_NONE;
+    order->last = ORDER_NONE;
+    /*
+     * Ranges of 2^i ranks hold at most (2 / T)^i elements, and never more
+     * than half their ranks, so that evenly spaced ranks are at least 2
+     * apart
+     * */
+    double max = 1;
+    order->max_count[0] = 0;
+    for (int i = 1; i <= ORDER_RANK_BITS; i++) {
+        max *= 2.0 * ORDER_DENSITY_DEN / ORDER_DENSITY_NUM;
+        uint64_t half = UINT64_C(1) << (i - 1);
+        order->max_count[i] = max < (double) half ? (uint64_t) max : half;
+    }
+}
+
+/*
+ * Gives the ids between from and to (included, in this order) evenly
+ * spaced ranks in the range of size ranks starting at base
+ * */
+static void order_relabel(struct order *order, uint32_t from, uint32_t to, uint64_t count, uint64_t base,
+                          uint64_t size) {
+    uint64_t step = size / count, rank = base + step / 2;
+    for (uint32_t id = from;; id = order->nodes[id].next) {
+        order->nodes[id].rank = rank;
+        rank += step;
+        if (id == to) {
+            break;
+        }
+    }
+}
+
+/*
+ * Makes room between the neighbours of id, which is already linked
+ * but has no rank: anchor is the rank of one of them. The smallest
+ * aligned range of ranks holding anchor that isn't too crowded
+ * (counting id) is relabeled, growing the stretch of the list inside
+ * it one level at a time
+ * */
+static void order_rebalance(struct order *order, uint32_t id, uint64_t anchor) {
+    uint32_t from = id, to = id;
+    uint64_t count = 1;
+    for (int i = 1; i <= ORDER_RANK_BITS; i++) {
+        uint64_t size = UINT64_C(1) << i, base = anchor & ~(size - 1);
+        uint32_t prev = order->nodes[from].prev, next = order->nodes[to].next;
+        while (prev != ORDER_NONE && order->nodes[prev].rank >= base) {
+            from = prev;
+            prev = order->nodes[prev].prev;
+            count++;
+        }
+        while (next != ORDER_NONE && order->nodes[next].rank - base < size) {
+            to = next;
+            next = order->nodes[next].next;
+            count++;
+        }
+        if (count <= order->max_count[i]) {
+            order_relabel(order, from, to, count, base, size);
+            return;
+        }
+    }
+    exit(666);
+}
+
+/*
+ * Adds id to the list right before next, or at the end if next is
+ * ORDER_NONE: id must not be in the list already
+ * */
+void order_insert_before(struct order *order, uint32_t id, uint32_t next) {
+    if (id >= order->size) {
+        size_t old_size = order->size;
+        while (id >= order->size) {
+            order->size *= ORDER_GROWTH_FACTOR;
+        }
+        order->nodes = slab_heap_realloc(order->nodes, sizeof(struct order_node) * old_size,
+                                         sizeof(struct order_node) * order->size);
+        if (order->nodes == NULL) {
+            exit(666);
+        }
+    }
+    struct order_node *nodes = order->nodes;
+    uint32_t prev = next == ORDER_NONE ? order->last : nodes[next].prev;
+    nodes[id].prev = prev;
+    nodes[id].next = next;
+    if (prev == ORDER_NONE) {
+        order->first = id;
+    } else {
+        nodes[prev].next = id;
+    }
+    if (next == ORDER_NONE) {
+        order->last = id;
+    } else {
+        nodes[next].prev = id;
+    }
+    /*
+     * Ranks are never 0, which stands for the start of the list here,
+     * as ORDER_RANK_LIMIT does for its end
+     * */
+    uint64_t low = prev == ORDER_NONE ? 0 : nodes[prev].rank;
+    uint64_t high = next == ORDER_NONE ? ORDER_RANK_LIMIT : nodes[next].rank;
+    uint64_t gap = high - low;
+    if (gap >= 2) {
+        uint64_t half = gap / 2;
+        if ((prev == ORDER_NONE || next == ORDER_NONE) && half > ORDER_END_GAP) {
+            half = ORDER_END_GAP;
+        }
+        nodes[id].rank = next == ORDER_NONE ? low + half : high - half;
+        return;
+    }
+    order_rebalance(order, id, prev == ORDER_NONE ? nodes[next].rank : nodes[prev].rank);
+}
+
+void order_remove(struct order *order, uint32_t id) {
+    struct order_node *nodes = order->nodes;
+    uint32_t prev = nodes[id].prev, next = nodes[id].next;
+    if (prev == ORDER_NONE) {
+        order->first = next;
+    } else {
+        nodes[prev].next = next;
+    }
+    if (next == ORDER_NONE) {
+        order->last = prev;
+    } else {
+        nodes[next].prev = prev;
+    }
+}
+
+static void order_insertion_sort(struct order_item *items, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        struct order_item cur = items[i];
+        size_t j = i;
+        while (j > 0 && cur.rank < items[j - 1].rank) {
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = cur;
+    }
+}
+
+/*
+ * Merge sort that skips the merge when the two halves are already in
+ * order, so items that are mostly sorted take few comparisons
+ * */
+static void order_merge_sort(struct order_item *items, size_t count, struct order_item *tmp) {
+    if (count <= ORDER_INSERTION_SORT_MAX) {
+        order_insertion_sort(items, count);
+        return;
+    }
+    size_t mid = count / 2;
+    order_merge_sort(items, mid, tmp);
+    order_merge_sort(items + mid, count - mid, tmp);
+    if (items[mid - 1].rank <= items[mid].rank) {
+        return;
+    }
+    memcpy(tmp, items, sizeof(struct order_item) * mid);
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < count) {
+        if (items[j].rank < tmp[i].rank) {
+            items[k++] = items[j++];
+        } else {
+            items[k++] = tmp[i++];
+        }
+    }
+    memcpy(items + k, tmp + i, sizeof(struct order_item) * (mid - i));
+}
+
+/*
+ * Least significant digit radix sort on the ranks, a byte at a time:
+ * the counts of all the bytes are taken in a single pass, and the
+ * bytes that are the same for every item are skipped
+ * */
+static void order_radix_sort(struct order_item *items, size_t count, struct order_item *tmp) {
+    size_t counts[sizeof(uint64_t)][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < count; i++) {
+        uint64_t rank = items[i].rank;
+        for (size_t b = 0; b < sizeof(uint64_t); b++) {
+            counts[b][(rank >> (b * 8)) & 0xff]++;
+        }
+    }
+    struct order_item *src = items, *dest = tmp;
+    for (size_t b = 0; b < sizeof(uint64_t); b++) {
+        size_t *digit_counts = counts[b];
+        if (digit_counts[(src[0].rank >> (b * 8)) & 0xff] == count) {
+            continue;
+        }
+        size_t pos = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t digit_count = digit_counts[d];
+            digit_counts[d] = pos;
+            pos += digit_count;
+        }
+        for (size_t i = 0; i < count; i++) {
+            dest[digit_counts[(src[i].rank >> (b * 8)) & 0xff]++] = src[i];
+        }
+        struct order_item *swap = src;
+        src = dest;
+        dest = swap;
+    }
+    if (src != items) {
+        memcpy(items, src, sizeof(struct order_item) * count);
+    }
+}
+
+/*
+ * Sorts items by rank, which is the order of their ids in the list.
+ * tmp must have room for count items
+ * */
+void order_sort(struct order_item *items, size_t count, struct order_item *tmp) {
+    if (count >= ORDER_RADIX_SORT_MIN) {
+        order_radix_sort(items, count, tmp);
+    } else {
+        order_merge_sort(items, count, tmp);
+    }
+}
+
+void order_destroy(struct order *order) {
+    slab_heap_free(order->nodes);
+}
@@ -0,0 +1,82 @@
+#ifndef PROVAFINALEAPI_ORDER_H
+#define PROVAFINALEAPI_ORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INITIAL_ORDER_SIZE 1024
+#define ORDER_GROWTH_FACTOR 2
+
+/*
+ * Ranks are below 1 << ORDER_RANK_BITS, which leaves room for
+ * about 2^32 elements with the thresholds below
+ * */
+#define ORDER_RANK_BITS 62
+#define ORDER_NONE UINT32_MAX
+
+/*
+ * Gap left after the last id (and before the first one), so that
+ * ids appended in order don't use up the ranks halving them
+ * */
+#define ORDER_END_GAP (UINT64_C(1) << 32)
+
+/*
+ * A range of 2^i ranks gets relabeled evenly once it would hold more
+ * than (2 / T)^i elements: T is ORDER_DENSITY_NUM / ORDER_DENSITY_DEN
+ * */
+#define ORDER_DENSITY_NUM 7
+#define ORDER_DENSITY_DEN 5
+
+/*
+ * Sets with at least this many elements are sorted by radix, smaller
+ * ones by merging
+ * */
+#define ORDER_RADIX_SORT_MIN 1024
+#define ORDER_INSERTION_SORT_MAX 16
+
+struct order_node {
+    uint64_t rank;
+    uint32_t prev;
+    uint32_t next;
+};
+
+/*
+ * Order maintenance: a list of ids (up to size) whose ranks grow along
+ * the list, so that comparing two ranks tells which id comes first.
+ * A new id gets the rank halfway between its neighbours; when there's
+ * none left, the smallest aligned range of ranks around it that is
+ * sparse enough is relabeled evenly, which takes O(log n) amortized
+ * relabels per insertion.
+ * max_count[i] is the most elements a range of 2^i ranks can hold
+ * */
+struct order {
+    struct order_node *nodes;
+    size_t size;
+    uint32_t first;
+    uint32_t last;
+    uint64_t max_count[ORDER_RANK_BITS + 1];
+};
+
+/*
+ * An id together with its rank, to be sorted with order_sort
+ * */
+struct order_item {
+    uint64_t rank;
+    uint32_t id;
+};
+
+void order_init(struct order *order);
+
+void order_insert_before(struct order *order, uint32_t id, uint32_t next);
+
+void order_remove(struct order *order, uint32_t id);
+
+static inline uint64_t order_rank(struct order *order, uint32_t id) {
+    return order->nodes[id].rank;
+}
+
+void order_sort(struct order_item *items, size_t count, struct order_item *tmp);
+
+void order_destroy(struct order *order);
+
+#endif //PROVAFINALEAPI_ORDER_H
@@ -0,0 +1,903 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include "persistence.h"
+#include "slab.h"
+
+/*
+ * Writes the whole state as commands that rebuild it
+ * when fed back as input
+ * */
+void dump_state(FILE *out, struct engine *engine) {
+    struct hash_table *mon_rel = engine->mon_rel;
+    struct str_arr *mon_ent_list = engine->mon_ent_list, *mon_rel_list = engine->mon_rel_list;
+    for (unsigned long int i = 0; i < mon_ent_list->next_free; i++) {
+        fprintf(out, "addent \"%s\"\n", str_arr_get(mon_ent_list, i));
+    }
+    for (unsigned long int j = 0; j < mon_rel_list->next_free; j++) {
+        char *cur_rel = str_arr_get(mon_rel_list, j);
+        struct dest_map *rel_table = ht_get(mon_rel, cur_rel);
+        size_t dest_pos = 0;
+        uint32_t dest, handle;
+        while (dest_map_next(rel_table, &dest_pos, &dest, &handle)) {
+            struct edge_set *dest_set = edge_set_pool_get(&engine->sets, handle);
+            size_t pos = 0;
+            uint32_t origin_id;
+            while (edge_set_next(dest_set, &pos, &origin_id)) {
+                fprintf(out, "addrel \"%s\" \"%s\" \"%s\"\n", engine->ent_names[origin_id],
+                        engine->ent_names[dest], cur_rel);
+            }
+        }
+    }
+    fputs("end\n", out);
+}
+
+void bg_dump_init(struct bg_dump *dump) {
+    dump->pid = 0;
+    dump->fork_ms = 0;
+    dump->parent_minflt = 0;
+}
+
+/*
+ * Reaps the last background dump (waiting for it if block is set)
+ * and prints its metrics on stderr
+ * */
+void bg_dump_reap(struct bg_dump *dump, int block) {
+    if (dump->pid <= 0) {
+        return;
+    }
+    int status;
+    struct rusage child_usage, parent_usage;
+    pid_t pid = wait4(dump->pid, &status, block ? 0 : WNOHANG, &child_usage);
+    if (pid == 0) {
+        return;
+    }
+    if (pid == dump->pid) {
+        getrusage(RUSAGE_SELF, &parent_usage);
+        fprintf(stderr, "snapshot: fork %.3f ms, child minor faults %ld, parent minor faults since fork %ld, status %d\n",
+                dump->fork_ms, child_usage.ru_minflt, parent_usage.ru_minflt - dump->parent_minflt,
+                WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    }
+    dump->pid = 0;
+}
+
+/*
+ * Forks and lets the child write the state to path while the
+ * parent goes on with the next commands: thanks to copy-on-write
+ * the child sees the state as it was at the time of the fork.
+ * Like BGSAVE, only one dump runs at a time: while one is in
+ * progress the request is skipped.
+ * Returns 0 if the dump was started, -1 otherwise
+ * */
+int bg_dump_start(struct bg_dump *dump, const char *path, struct engine *engine) {
+    bg_dump_reap(dump, 0);
+    if (dump->pid > 0) {
+        fprintf(stderr, "snapshot: a dump is already in progress, %s skipped\n", path);
+        return -1;
+    }
+
+    struct timespec start, end;
+    struct rusage usage;
+    engine_flush(engine);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0) {
+        FILE *out = fopen(path, "w");
+        if (out == NULL) {
+            _exit(1);
+        }
+        dump_state(out, engine);
+        _exit(fclose(out) == 0 ? 0 : 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (pid < 0) {
+        fprintf(stderr, "snapshot: fork failed\n");
+        return -1;
+    }
+    getrusage(RUSAGE_SELF, &usage);
+    dump->pid = pid;
+    dump->fork_ms = (double) (end.tv_sec - start.tv_sec) * 1000 + (double) (end.tv_nsec - start.tv_nsec) / 1000000;
+    dump->parent_minflt = usage.ru_minflt;
+    return 0;
+}
+
+/*
+ * Checkpoint file layout: an image of the monitored state, in the
+ * layout the engine itself uses, so that loading it is mapping it and
+ * turning offsets back into pointers.
+ *
+ * header: magic, version, WAL generation, word size, header size and
+ *     a copy of every structure of the engine (tables, index, order,
+ *     filter, lists, edge set pool, free ids, id arrays)
+ * the blocks they point to, each one aligned to 8 bytes (the blocks of
+ *     the filter to a cache line), and zero padding at the end
+ *
+ * Every pointer, in the header or in a block, is stored as the offset
+ * of the block it points to (0 for NULL, since the header is at 0):
+ * items of tables are followed by their keys, like in ht_new_item,
+ * leaves of ent_index are the offsets of items of mon_ent with the
+ * lowest bit set, and ent_names holds offsets of their keys.
+ * Arrays only take the room of what's in them, and every array edge
+ * set only its ids, so the first one to grow is copied out of the file
+ * */
+struct checkpoint_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t generation;
+    uint32_t word_size;
+    uint64_t header_size;
+    struct hash_table mon_ent;
+    struct hash_table mon_rel;
+    struct hash_table cache;
+    struct art ent_index;
+    struct order ent_order;
+    struct bloom ent_filter;
+    struct str_arr mon_ent_list;
+    struct str_arr mon_rel_list;
+    struct edge_set_pool sets;
+    struct u32_vec free_ids;
+    uint64_t ent_names;
+    uint64_t ent_pos;
+    uint64_t ent_ids_size;
+    uint64_t next_ent_id;
+};
+
+#define CHECKPOINT_OFFSET_PTR(offset) ((void *) (uintptr_t) (offset))
+#define CHECKPOINT_PTR_OFFSET(ptr) ((uint64_t) (uintptr_t) (ptr))
+
+/*
+ * ent_offsets maps entity ids to the offsets of their items in mon_ent,
+ * once it's written
+ * */
+struct checkpoint_writer {
+    FILE *out;
+    uint64_t pos;
+    uint64_t *ent_offsets;
+};
+
+static const char checkpoint_zeros[CHECKPOINT_BLOCK_ALIGNMENT * 8];
+
+/*
+ * Writes len bytes of block at the next multiple of align, returns
+ * their offset
+ * */
+static uint64_t checkpoint_put_aligned(struct checkpoint_writer *writer, const void *block, size_t len,
+                                       size_t align) {
+    size_t pad = (align - writer->pos % align) % align;
+    fwrite(checkpoint_zeros, sizeof(char), pad, writer->out);
+    writer->pos += pad;
+    uint64_t offset = writer->pos;
+    fwrite(block, sizeof(char), len, writer->out);
+    writer->pos += len;
+    return offset;
+}
+
+static uint64_t checkpoint_put(const void *block, size_t len, void *data) {
+    return checkpoint_put_aligned(data, block, len, CHECKPOINT_BLOCK_ALIGNMENT);
+}
+
+/*
+ * Writes the len bytes of an array followed by zeros up to size
+ * bytes, the capacity it's loaded with
+ * */
+static uint64_t checkpoint_put_array(struct checkpoint_writer *writer, const void *block, size_t len,
+                                     size_t size) {
+    uint64_t offset = checkpoint_put(block, len, writer);
+    size_t pad = size - len;
+    while (pad > 0) {
+        size_t n = pad < sizeof(checkpoint_zeros) ? pad : sizeof(checkpoint_zeros);
+        fwrite(checkpoint_zeros, sizeof(char), n, writer->out);
+        writer->pos += n;
+        pad -= n;
+    }
+    return offset;
+}
+
+/*
+ * Writes the index, entries and items of ht, with the values
+ * write_value returns (it may write the blocks they point to), and
+ * sets image to ht as it's stored in the header.
+ * item_offsets, if not NULL, gets the offset of the item of every entry
+ * */
+static void checkpoint_write_table(struct checkpoint_writer *writer, struct hash_table *ht,
+                                   struct hash_table *image, uint64_t *item_offsets,
+                                   uint64_t (*write_value)(struct checkpoint_writer *writer, void *value)) {
+    struct ht_entry *entries = malloc(sizeof(struct ht_entry) * (ht->used + 1));
+    if (entries == NULL) {
+        exit(666);
+    }
+    for (unsigned long int i = 0; i < ht->used; i++) {
+        struct ht_item *item = ht->entries[i].item;
+        uint64_t offset = 0;
+        if (item != NULL) {
+            struct ht_item copy = {NULL, item->value};
+            if (write_value != NULL) {
+                copy.value = CHECKPOINT_OFFSET_PTR(write_value(writer, item->value));
+            }
+            offset = checkpoint_put(&copy, sizeof(struct ht_item), writer);
+            fwrite(item->key, sizeof(char), strlen(item->key) + 1, writer->out);
+            writer->pos += strlen(item->key) + 1;
+        }
+        if (item_offsets != NULL) {
+            item_offsets[i] = offset;
+        }
+        entries[i].hash = ht->entries[i].hash;
+        entries[i].item = CHECKPOINT_OFFSET_PTR(offset);
+    }
+    *image = *ht;
+    image->entries_size = ht->used;
+    image->entries = CHECKPOINT_OFFSET_PTR(
+            ht->used > 0 ? checkpoint_put(entries, sizeof(struct ht_entry) * ht->used, writer) : 0);
+    image->index = CHECKPOINT_OFFSET_PTR(checkpoint_put(ht->index, sizeof(int32_t) * ht->size, writer));
+    free(entries);
+}
+
+/*
+ * Writes the dest_map value of mon_rel and its slots
+ * */
+static uint64_t checkpoint_write_dest_map(struct checkpoint_writer *writer, void *value) {
+    struct dest_map copy = *(struct dest_map *) value;
+    copy.slots = CHECKPOINT_OFFSET_PTR(checkpoint_put(copy.slots, sizeof(struct dest_slot) * copy.size, writer));
+    return checkpoint_put(&copy, sizeof(struct dest_map), writer);
+}
+
+/*
+ * Writes the report_cache value of cache and its ids, but not its
+ * text, which is rendered again after loading
+ * */
+static uint64_t checkpoint_write_report_cache(struct checkpoint_writer *writer, void *value) {
+    struct report_cache copy = *(struct report_cache *) value;
+    copy.ents.size = copy.ents.len > 0 ? copy.ents.len : 1;
+    copy.ents.items = CHECKPOINT_OFFSET_PTR(checkpoint_put_array(writer, copy.ents.items,
+                                                                 sizeof(uint32_t) * copy.ents.len,
+                                                                 sizeof(uint32_t) * copy.ents.size));
+    copy.text = NULL;
+    copy.text_len = 0;
+    copy.changed_seq = 0;
+    copy.rendered_seq = 0;
+    return checkpoint_put(&copy, sizeof(struct report_cache), writer);
+}
+
+static void checkpoint_write_vec(struct checkpoint_writer *writer, struct u32_vec *vec, struct u32_vec *image) {
+    *image = *vec;
+    image->size = vec->len > 0 ? vec->len : 1;
+    image->items = CHECKPOINT_OFFSET_PTR(checkpoint_put_array(writer, vec->items, sizeof(uint32_t) * vec->len,
+                                                              sizeof(uint32_t) * image->size));
+}
+
+static void checkpoint_write_list(struct checkpoint_writer *writer, struct str_arr *arr, struct str_arr *image) {
+    *image = *arr;
+    image->size = arr->next_free > 0 ? arr->next_free : 1;
+    image->heap_size = arr->heap_len > 0 ? arr->heap_len : 1;
+    image->array = CHECKPOINT_OFFSET_PTR(checkpoint_put_array(writer, arr->array,
+                                                              sizeof(struct str_ref) * arr->next_free,
+                                                              sizeof(struct str_ref) * image->size));
+    image->heap = CHECKPOINT_OFFSET_PTR(checkpoint_put_array(writer, arr->heap, arr->heap_len, image->heap_size));
+}
+
+/*
+ * Writes every edge set of the pool: the ids of array sets (only as
+ * many as there are) or the words of bitmaps, then the sets themselves.
+ * Deleted sets are stored empty
+ * */
+static void checkpoint_write_sets(struct checkpoint_writer *writer, struct edge_set_pool *pool,
+                                  struct edge_set_pool *image) {
+    size_t size = pool->count > 0 ? pool->count : 1;
+    struct edge_set *sets = calloc(size, sizeof(struct edge_set));
+    char *deleted = calloc(size, sizeof(char));
+    if (sets == NULL || deleted == NULL) {
+        exit(666);
+    }
+    for (size_t i = 0; i < pool->free_handles.len; i++) {
+        deleted[pool->free_handles.items[i]] = 1;
+    }
+    for (uint32_t handle = 0; handle < pool->count; handle++) {
+        struct edge_set *set = &pool->sets[handle];
+        if (deleted[handle]) {
+            continue;
+        }
+        sets[handle].count = set->count;
+        if (set->bits != NULL) {
+            sets[handle].size = set->size;
+            sets[handle].bits = CHECKPOINT_OFFSET_PTR(checkpoint_put(set->bits, sizeof(uint64_t) * set->size,
+                                                                     writer));
+        } else {
+            sets[handle].size = set->count > 0 ? set->count : 1;
+            sets[handle].ids = CHECKPOINT_OFFSET_PTR(checkpoint_put_array(writer, set->ids,
+                                                                          sizeof(uint32_t) * set->count,
+                                                                          sizeof(uint32_t) * sets[handle].size));
+        }
+    }
+    *image = *pool;
+    image->size = (uint32_t) size;
+    image->sets = CHECKPOINT_OFFSET_PTR(checkpoint_put(sets, sizeof(struct edge_set) * size, writer));
+    checkpoint_write_vec(writer, &pool->free_handles, &image->free_handles);
+    free(deleted);
+    free(sets);
+}
+
+/*
+ * Leaves of ent_index are items of mon_ent
+ * */
+static uint64_t checkpoint_leaf_offset(struct ht_item *item, void *data) {
+    return ((struct checkpoint_writer *) data)->ent_offsets[ENT_VALUE_TO_ID(item->value)];
+}
+
+/*
+ * Returns 0 on success, -1 if path could not be written
+ * */
+int checkpoint_write(struct engine *engine, const char *path, uint32_t generation) {
+    struct hash_table *mon_ent = engine->mon_ent;
+    engine_flush(engine);
+    /*
+     * Write to a temporary file first, so that a crash never
+     * leaves a half written checkpoint at path
+     * */
+    char *tmp_path = malloc(strlen(path) + sizeof(CHECKPOINT_TMP_SUFFIX));
+    if (tmp_path == NULL) {
+        exit(666);
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, CHECKPOINT_TMP_SUFFIX);
+    FILE *out = fopen(tmp_path, "wb");
+    if (out == NULL) {
+        free(tmp_path);
+        return -1;
+    }
+    /*
+     * item_offsets holds the offsets of the items of mon_ent by entry
+     * */
+    uint64_t *item_offsets = malloc(sizeof(uint64_t) * (mon_ent->used + 1));
+    uint64_t *ent_offsets = malloc(sizeof(uint64_t) * (engine->ent_ids_size + 1));
+    if (item_offsets == NULL || ent_offsets == NULL) {
+        exit(666);
+    }
+
+    /*
+     * The header is written again at the end, once it's filled in
+     * */
+    struct checkpoint_header header;
+    memset(&header, 0, sizeof(struct checkpoint_header));
+    struct checkpoint_writer writer = {out, 0, ent_offsets};
+    checkpoint_put(&header, sizeof(struct checkpoint_header), &writer);
+
+    checkpoint_write_table(&writer, mon_ent, &header.mon_ent, item_offsets, NULL);
+    for (unsigned long int i = 0; i < mon_ent->used; i++) {
+        if (mon_ent->entries[i].item != NULL) {
+            ent_offsets[ENT_VALUE_TO_ID(mon_ent->entries[i].item->value)] = item_offsets[i];
+        }
+    }
+    size_t ent_ids_size = engine->next_ent_id > 0 ? engine->next_ent_id : 1;
+    uint64_t *ent_names = calloc(ent_ids_size, sizeof(uint64_t));
+    if (ent_names == NULL) {
+        exit(666);
+    }
+    for (uint32_t id = 0; id < engine->next_ent_id; id++) {
+        if (engine->ent_names[id] != NULL) {
+            ent_names[id] = ent_offsets[id] + sizeof(struct ht_item);
+        }
+    }
+    header.ent_ids_size = ent_ids_size;
+    header.next_ent_id = engine->next_ent_id;
+    header.ent_names = checkpoint_put(ent_names, sizeof(uint64_t) * ent_ids_size, &writer);
+    header.ent_pos = checkpoint_put(engine->ent_pos, sizeof(uint32_t) * ent_ids_size, &writer);
+    free(ent_names);
+    header.ent_order = engine->ent_order;
+    header.ent_order.size = ent_ids_size;
+    header.ent_order.nodes = CHECKPOINT_OFFSET_PTR(checkpoint_put(engine->ent_order.nodes,
+                                                                  sizeof(struct order_node) * ent_ids_size,
+                                                                  &writer));
+    checkpoint_write_vec(&writer, &engine->free_ids, &header.free_ids);
+    header.ent_filter = engine->ent_filter;
+    header.ent_filter.blocks = CHECKPOINT_OFFSET_PTR(checkpoint_put_aligned(
+            &writer, engine->ent_filter.blocks,
+            sizeof(uint64_t) * BLOOM_BLOCK_WORDS * engine->ent_filter.block_count,
+            sizeof(uint64_t) * BLOOM_BLOCK_WORDS));
+    header.ent_index = engine->ent_index;
+    header.ent_index.root = CHECKPOINT_OFFSET_PTR(art_write(&engine->ent_index, checkpoint_put,
+                                                            checkpoint_leaf_offset, &writer));
+    checkpoint_write_list(&writer, engine->mon_ent_list, &header.mon_ent_list);
+    checkpoint_write_list(&writer, engine->mon_rel_list, &header.mon_rel_list);
+    checkpoint_write_sets(&writer, &engine->sets, &header.sets);
+    checkpoint_write_table(&writer, engine->mon_rel, &header.mon_rel, NULL, checkpoint_write_dest_map);
+    checkpoint_write_table(&writer, engine->cache, &header.cache, NULL, checkpoint_write_report_cache);
+    checkpoint_put_aligned(&writer, checkpoint_zeros, CHECKPOINT_BLOCK_ALIGNMENT, 1);
+
+    memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+    header.version = CHECKPOINT_VERSION;
+    header.generation = generation;
+    header.word_size = sizeof(void *);
+    header.header_size = sizeof(struct checkpoint_header);
+    free(ent_offsets);
+    free(item_offsets);
+    int ret = 0;
+    if (fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(struct checkpoint_header), 1, out) != 1) {
+        ret = -1;
+    }
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        ret = -1;
+    }
+    if (fclose(out) != 0) {
+        ret = -1;
+    }
+    if (ret == 0) {
+        ret = rename(tmp_path, path);
+    }
+    free(tmp_path);
+    return ret;
+}
+
+/*
+ * A mapped checkpoint: offsets are turned into pointers only after
+ * checking that the block they point to is in the file
+ * */
+struct checkpoint_map {
+    char *data;
+    size_t len;
+};
+
+/*
+ * Returns the address of the len bytes at offset, exiting if they
+ * aren't all in the file
+ * */
+static void *checkpoint_at(uint64_t offset, size_t len, void *data) {
+    struct checkpoint_map *map = data;
+    if (offset < sizeof(struct checkpoint_header) || offset % CHECKPOINT_BLOCK_ALIGNMENT != 0 ||
+        offset > map->len || len > map->len - offset) {
+        fprintf(stderr, "checkpoint: bad offset\n");
+        exit(666);
+    }
+    return map->data + offset;
+}
+
+/*
+ * Like checkpoint_at, for an array of count elements stored at the
+ * offset held in ptr: an empty array is NULL
+ * */
+static void *checkpoint_array(struct checkpoint_map *map, void *ptr, size_t count, size_t size) {
+    if (count == 0) {
+        return NULL;
+    }
+    if (count > map->len / size) {
+        fprintf(stderr, "checkpoint: bad offset\n");
+        exit(666);
+    }
+    return checkpoint_at(CHECKPOINT_PTR_OFFSET(ptr), count * size, map);
+}
+
+static void checkpoint_check(int ok) {
+    if (!ok) {
+        fprintf(stderr, "checkpoint: bad structure\n");
+        exit(666);
+    }
+}
+
+static void checkpoint_load_dest_map(struct checkpoint_map *map, struct ht_item *item) {
+    struct dest_map *rel_table = checkpoint_at(CHECKPOINT_PTR_OFFSET(item->value), sizeof(struct dest_map), map);
+    checkpoint_check(rel_table->size > 0 && (rel_table->size & (rel_table->size - 1)) == 0);
+    rel_table->slots = checkpoint_array(map, rel_table->slots, rel_table->size, sizeof(struct dest_slot));
+    item->value = rel_table;
+}
+
+static void checkpoint_load_report_cache(struct checkpoint_map *map, struct ht_item *item) {
+    struct report_cache *cache_entry = checkpoint_at(CHECKPOINT_PTR_OFFSET(item->value),
+                                                     sizeof(struct report_cache), map);
+    checkpoint_check(cache_entry->ents.len <= cache_entry->ents.size && cache_entry->ents.size > 0);
+    cache_entry->ents.items = checkpoint_array(map, cache_entry->ents.items, cache_entry->ents.len,
+                                               sizeof(uint32_t));
+    item->value = cache_entry;
+}
+
+/*
+ * Replaces the (empty) arrays of ht with the ones of image, and
+ * turns the offsets of its items (and of their values, with
+ * load_value) into pointers
+ * */
+static void checkpoint_load_table(struct checkpoint_map *map, struct hash_table *ht, struct hash_table *image,
+                                  void (*load_value)(struct checkpoint_map *map, struct ht_item *item)) {
+    checkpoint_check(image->size > 0 && (image->size & (image->size - 1)) == 0 &&
+                     image->count <= image->used && image->used < image->size);
+    slab_heap_free(ht->index);
+    slab_heap_free(ht->entries);
+    *ht = *image;
+    ht->entries_size = ht->used;
+    ht->index = checkpoint_array(map, ht->index, ht->size, sizeof(int32_t));
+    ht->entries = checkpoint_array(map, ht->entries, ht->used, sizeof(struct ht_entry));
+    for (unsigned long int i = 0; i < ht->used; i++) {
+        struct ht_entry *entry = &ht->entries[i];
+        if (entry->item != NULL) {
+            entry->item = checkpoint_at(CHECKPOINT_PTR_OFFSET(entry->item), sizeof(struct ht_item), map);
+            entry->item->key = (char *) (entry->item + 1);
+            if (load_value != NULL) {
+                load_value(map, entry->item);
+            }
+        }
+    }
+}
+
+static void checkpoint_load_vec(struct checkpoint_map *map, struct u32_vec *vec, struct u32_vec *image) {
+    checkpoint_check(image->len <= image->size && image->size > 0);
+    *vec = *image;
+    vec->items = checkpoint_array(map, vec->items, vec->size, sizeof(uint32_t));
+}
+
+static void checkpoint_load_list(struct checkpoint_map *map, struct str_arr *arr, struct str_arr *image) {
+    checkpoint_check(image->next_free <= image->size && image->heap_len <= image->heap_size &&
+                     image->size > 0 && image->heap_size > 0);
+    slab_heap_free(arr->array);
+    slab_heap_free(arr->heap);
+    *arr = *image;
+    arr->array = checkpoint_array(map, arr->array, arr->size, sizeof(struct str_ref));
+    arr->heap = checkpoint_array(map, arr->heap, arr->heap_size, sizeof(char));
+}
+
+static void checkpoint_load_sets(struct checkpoint_map *map, struct edge_set_pool *pool,
+                                 struct edge_set_pool *image) {
+    checkpoint_check(image->count <= image->size && image->size > 0);
+    edge_set_pool_destroy(pool);
+    *pool = *image;
+    pool->sets = checkpoint_array(map, pool->sets, pool->size, sizeof(struct edge_set));
+    for (uint32_t handle = 0; handle < pool->count; handle++) {
+        struct edge_set *set = &pool->sets[handle];
+        if (set->bits != NULL) {
+            set->bits = checkpoint_array(map, set->bits, set->size, sizeof(uint64_t));
+        } else if (set->ids != NULL) {
+            checkpoint_check(set->count <= set->size);
+            set->ids = checkpoint_array(map, set->ids, set->size, sizeof(uint32_t));
+        }
+    }
+    checkpoint_load_vec(map, &pool->free_handles, &image->free_handles);
+}
+
+/*
+ * Loads the checkpoint at path into the (empty) state, in place:
+ * the file is mapped privately and the engine is handed its tables,
+ * index, order, filter, lists and edge sets right where they are in
+ * the mapping, after turning the offsets in them into pointers.
+ * Nothing is hashed, sorted, inserted or copied: the mapping is a
+ * slab region, so the blocks in it are never freed, and the first
+ * array that has to grow is copied out of it. It stays mapped until
+ * engine_destroy.
+ * Only where offsets point is checked, the contents of a checkpoint
+ * are trusted.
+ * The WAL generation of the checkpoint becomes the one of engine.
+ * Returns 0 on success, -1 if path could not be opened, -2 if
+ * it's not a checkpoint file
+ * */
+int checkpoint_load(struct engine *engine, const char *path) {
+    if (engine->mon_ent->count > 0 || engine->mon_rel->count > 0 || engine->checkpoint_map != NULL) {
+        fprintf(stderr, "checkpoint: %s can only be loaded into an empty state\n", path);
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 4) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    struct checkpoint_map map = {data, (size_t) st.st_size};
+    struct checkpoint_header header;
+    memset(&header, 0, sizeof(struct checkpoint_header));
+    if (map.len >= sizeof(struct checkpoint_header)) {
+        memcpy(&header, data, sizeof(struct checkpoint_header));
+    }
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0 || header.version != CHECKPOINT_VERSION ||
+        header.word_size != sizeof(void *) || header.header_size != sizeof(struct checkpoint_header) ||
+        map.data[map.len - 1] != '\0') {
+        fprintf(stderr, "checkpoint: %s is not a checkpoint file\n", path);
+        munmap(data, map.len);
+        return -2;
+    }
+    if (slab_add_region(data, map.len) != 0) {
+        fprintf(stderr, "checkpoint: too many checkpoints mapped to load %s\n", path);
+        munmap(data, map.len);
+        return -1;
+    }
+
+    /*
+     * Keys are followed by the padding at the end of the file at
+     * worst, so they're all terminated
+     * */
+    checkpoint_load_table(&map, engine->mon_ent, &header.mon_ent, NULL);
+    checkpoint_load_table(&map, engine->mon_rel, &header.mon_rel, checkpoint_load_dest_map);
+    checkpoint_load_table(&map, engine->cache, &header.cache, checkpoint_load_report_cache);
+
+    checkpoint_check(header.next_ent_id <= header.ent_ids_size && header.ent_ids_size > 0 &&
+                     header.ent_order.size == header.ent_ids_size);
+    slab_heap_free(engine->ent_names);
+    slab_heap_free(engine->ent_pos);
+    engine->ent_ids_size = header.ent_ids_size;
+    engine->next_ent_id = (uint32_t) header.next_ent_id;
+    engine->ent_names = checkpoint_array(&map, CHECKPOINT_OFFSET_PTR(header.ent_names), engine->ent_ids_size,
+                                         sizeof(char *));
+    engine->ent_pos = checkpoint_array(&map, CHECKPOINT_OFFSET_PTR(header.ent_pos), engine->ent_ids_size,
+                                       sizeof(uint32_t));
+    for (uint32_t id = 0; id < engine->next_ent_id; id++) {
+        if (engine->ent_names[id] != NULL) {
+            engine->ent_names[id] = checkpoint_at(CHECKPOINT_PTR_OFFSET(engine->ent_names[id]) -
+                                                  sizeof(struct ht_item), sizeof(struct ht_item), &map);
+            engine->ent_names[id] += sizeof(struct ht_item);
+        }
+    }
+    order_destroy(&engine->ent_order);
+    engine->ent_order = header.ent_order;
+    engine->ent_order.nodes = checkpoint_array(&map, engine->ent_order.nodes, engine->ent_order.size,
+                                               sizeof(struct order_node));
+    u32_vec_destroy(&engine->free_ids);
+    checkpoint_load_vec(&map, &engine->free_ids, &header.free_ids);
+    checkpoint_check(header.ent_filter.block_count > 0 &&
+                     (header.ent_filter.block_count & (header.ent_filter.block_count - 1)) == 0);
+    bloom_destroy(&engine->ent_filter);
+    engine->ent_filter = header.ent_filter;
+    engine->ent_filter.blocks = checkpoint_array(&map, engine->ent_filter.blocks,
+                                                 engine->ent_filter.block_count * BLOOM_BLOCK_WORDS,
+                                                 sizeof(uint64_t));
+    engine->ent_filter.lookups = 0;
+    engine->ent_filter.misses = 0;
+    engine->ent_filter.active = 1;
+    art_destroy(&engine->ent_index);
+    engine->ent_index = header.ent_index;
+    art_relocate(&engine->ent_index, checkpoint_at, &map);
+    checkpoint_load_list(&map, engine->mon_ent_list, &header.mon_ent_list);
+    checkpoint_load_list(&map, engine->mon_rel_list, &header.mon_rel_list);
+    checkpoint_load_sets(&map, &engine->sets, &header.sets);
+
+    engine->generation = header.generation;
+    engine->checkpoint_map = data;
+    engine->checkpoint_map_len = map.len;
+    return 0;
+}
+
+/*
+ * Unmaps the checkpoint engine was loaded from, once nothing
+ * uses it anymore
+ * */
+void checkpoint_unmap(struct engine *engine) {
+    if (engine->checkpoint_map == NULL) {
+        return;
+    }
+    slab_remove_region(engine->checkpoint_map);
+    munmap(engine->checkpoint_map, engine->checkpoint_map_len);
+    engine->checkpoint_map = NULL;
+}
+
+/*
+ * Loads the checkpoint to start from: the one at path if one was
+ * asked for, otherwise the one at DEFAULT_CHECKPOINT_FILE, if there
+ * is one, when the WAL is enabled (the log only applies on top of it).
+ * Without either nothing is loaded, so a stray checkpoint file never
+ * changes the results of a plain run.
+ * Exits if a checkpoint that was asked for can't be loaded
+ * */
+void checkpoint_load_startup(struct engine *engine, const char *path, int wal_enabled) {
+    if (path != NULL) {
+        if (checkpoint_load(engine, path) != 0) {
+            fprintf(stderr, "checkpoint: could not load %s\n", path);
+            exit(1);
+        }
+    } else if (wal_enabled && checkpoint_load(engine, DEFAULT_CHECKPOINT_FILE) == -2) {
+        exit(1);
+    }
+}
+
+void wal_write_header(struct wal *wal) {
+    fwrite(WAL_MAGIC, sizeof(char), 4, wal->file);
+    fwrite(&wal->generation, sizeof(uint32_t), 1, wal->file);
+}
+
+/*
+ * Reads the name of a record into name, returns 0 if the
+ * record is truncated
+ * */
+int wal_read_name(FILE *in, char *name) {
+    uint32_t len;
+    if (fread(&len, sizeof(uint32_t), 1, in) != 1 || len >= WAL_MAX_NAME_LENGTH) {
+        return 0;
+    }
+    if (fread(name, sizeof(char), len, in) != len) {
+        return 0;
+    }
+    name[len] = '\0';
+    return 1;
+}
+
+/*
+ * Applies every complete record of the log to engine, straight
+ * through run_command.
+ * Returns the file offset right after the last complete record
+ * */
+long wal_replay(FILE *in, struct engine *engine) {
+    char names[3][WAL_MAX_NAME_LENGTH];
+    struct command command = {0, {names[0], names[1], names[2]}};
+    long end = ftell(in);
+    int op;
+    while ((op = fgetc(in)) != EOF) {
+        int n_names = op == CMD_ADD_REL || op == CMD_DEL_REL ? 3 : 1;
+        int complete = op >= CMD_ADD_ENT && op <= CMD_DEL_REL;
+        for (int i = 0; complete && i < n_names; i++) {
+            complete = wal_read_name(in, names[i]);
+        }
+        if (!complete) {
+            break;
+        }
+        command.action = op;
+        run_command(engine, &command, NULL);
+        end = ftell(in);
+    }
+    /*
+     * Nothing replayed may still be pending once the log is attached,
+     * or it would be logged again
+     * */
+    engine_flush(engine);
+    return end;
+}
+
+/*
+ * Opens the log at path and attaches it to engine: if it belongs to the
+ * generation of engine it's replayed and then extended, otherwise it's
+ * started over
+ * */
+struct wal *wal_open(struct engine *engine, const char *path) {
+    struct wal *wal = malloc(sizeof(struct wal));
+    if (wal == NULL) {
+        exit(666);
+    }
+    wal->file = fopen(path, "r+b");
+    if (wal->file == NULL) {
+        wal->file = fopen(path, "w+b");
+    }
+    if (wal->file == NULL) {
+        fprintf(stderr, "wal: could not open %s\n", path);
+        exit(666);
+    }
+    wal->buffer = malloc(WAL_BUFFER_SIZE);
+    if (wal->buffer == NULL) {
+        exit(666);
+    }
+    setvbuf(wal->file, wal->buffer, _IOFBF, WAL_BUFFER_SIZE);
+    wal->generation = engine->generation;
+    wal->pending = 0;
+
+    char magic[4];
+    uint32_t wal_generation;
+    long end = 0;
+    if (fread(magic, sizeof(char), 4, wal->file) == 4 && memcmp(magic, WAL_MAGIC, 4) == 0 &&
+        fread(&wal_generation, sizeof(uint32_t), 1, wal->file) == 1 && wal_generation == wal->generation) {
+        end = wal_replay(wal->file, engine);
+    }
+    /*
+     * Drop a torn record at the tail (or the whole log if it
+     * belongs to an older checkpoint)
+     * */
+    fflush(wal->file);
+    if (ftruncate(fileno(wal->file), end) != 0) {
+        exit(666);
+    }
+    fseek(wal->file, end, SEEK_SET);
+    if (end == 0) {
+        wal_write_header(wal);
+    }
+    engine->wal = wal;
+    return wal;
+}
+
+void wal_sync(struct wal *wal) {
+    if (fflush(wal->file) != 0 || fsync(fileno(wal->file)) != 0) {
+        fprintf(stderr, "wal: sync failed\n");
+        exit(666);
+    }
+    wal->pending = 0;
+}
+
+/*
+ * Returns the milliseconds since the oldest record still to be synced
+ * */
+static long wal_pending_ms(struct wal *wal) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - wal->first_pending.tv_sec) * 1000 +
+           (now.tv_nsec - wal->first_pending.tv_nsec) / 1000000;
+}
+
+/*
+ * Syncs the pending records if force is set or the oldest of them
+ * has been waiting for the group commit interval
+ * */
+void wal_commit(struct wal *wal, int force) {
+    if (wal->pending == 0) {
+        return;
+    }
+    if (!force && wal_pending_ms(wal) < WAL_GROUP_COMMIT_INTERVAL_MS) {
+        return;
+    }
+    wal_sync(wal);
+}
+
+/*
+ * Returns how many milliseconds wal_commit can wait before the
+ * pending records are due, -1 if there are none
+ * */
+long wal_commit_timeout(struct wal *wal) {
+    if (wal->pending == 0) {
+        return -1;
+    }
+    long left = WAL_GROUP_COMMIT_INTERVAL_MS - wal_pending_ms(wal);
+    return left > 0 ? left : 0;
+}
+
+void wal_append(struct wal *wal, int op, char *name1, char *name2, char *name3) {
+    char *names[3] = {name1, name2, name3};
+    if (wal->pending == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &wal->first_pending);
+    }
+    fputc(op, wal->file);
+    for (int i = 0; i < 3 && names[i] != NULL; i++) {
+        uint32_t len = (uint32_t) strlen(names[i]);
+        fwrite(&len, sizeof(uint32_t), 1, wal->file);
+        fwrite(names[i], sizeof(char), len, wal->file);
+    }
+    wal->pending++;
+    if (wal->pending >= WAL_GROUP_COMMIT_SIZE) {
+        wal_sync(wal);
+    }
+}
+
+/*
+ * Starts an empty log for generation, after a checkpoint
+ * made the previous one useless
+ * */
+void wal_reset(struct wal *wal, uint32_t generation) {
+    fflush(wal->file);
+    if (ftruncate(fileno(wal->file), 0) != 0) {
+        exit(666);
+    }
+    rewind(wal->file);
+    wal->generation = generation;
+    wal_write_header(wal);
+    wal_sync(wal);
+}
+
+void wal_close(struct wal *wal) {
+    wal_sync(wal);
+    fclose(wal->file);
+    free(wal->buffer);
+    free(wal);
+}
+
+/*
+ * Writes a checkpoint of engine to path. Only the one at
+ * DEFAULT_CHECKPOINT_FILE is loaded at startup, so only that one
+ * starts a new generation and makes the log useless.
+ * Returns 0 on success, -1 if path could not be written
+ * */
+int checkpoint(struct engine *engine, const char *path) {
+    int is_default = strcmp(path, DEFAULT_CHECKPOINT_FILE) == 0;
+    uint32_t generation = is_default ? engine->generation + 1 : engine->generation;
+    if (checkpoint_write(engine, path, generation) != 0) {
+        return -1;
+    }
+    if (is_default) {
+        engine->generation = generation;
+        if (engine->wal != NULL) {
+            wal_reset(engine->wal, generation);
+        }
+    }
+    return 0;
+}
+
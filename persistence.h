@@ -0,0 +1,93 @@
+#ifndef PROVAFINALEAPI_PERSISTENCE_H
+#define PROVAFINALEAPI_PERSISTENCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "engine.h"
+
+#define DEFAULT_SNAPSHOT_FILE "snapshot.txt"
+#define DEFAULT_CHECKPOINT_FILE "checkpoint.bin"
+#define CHECKPOINT_TMP_SUFFIX ".tmp"
+
+#define CHECKPOINT_MAGIC "PFCK"
+#define CHECKPOINT_VERSION 3
+/*
+ * Blocks of a checkpoint start at multiples of this
+ * */
+#define CHECKPOINT_BLOCK_ALIGNMENT 8
+
+#define DEFAULT_WAL_FILE "wal.bin"
+#define WAL_MAGIC "PFWL"
+#define WAL_GROUP_COMMIT_SIZE 4096
+#define WAL_GROUP_COMMIT_INTERVAL_MS 10
+#define WAL_BUFFER_SIZE 65536
+#define WAL_MAX_NAME_LENGTH 256
+
+/*
+ * State of the last background dump: fork latency and page faults
+ * are reported once it's reaped. The parent faults are counted from
+ * the fork to the reap, which happens after every command (and every
+ * server loop round), so they're an upper bound for the copy-on-write
+ * faults the dump caused: anything else the parent did in between
+ * is counted too
+ * */
+struct bg_dump {
+    pid_t pid;
+    double fork_ms;
+    long parent_minflt;
+};
+
+/*
+ * Write-ahead log of the mutating commands since the last checkpoint.
+ * The file starts with WAL_MAGIC and the generation of the checkpoint
+ * it applies to, followed by records made of an operation code and
+ * its names (stored like in checkpoints, without the '\0').
+ * Records are buffered and synced to disk in groups: every
+ * WAL_GROUP_COMMIT_SIZE records, before every report (so a report
+ * never shows a change that could still be lost), and in the server
+ * at most WAL_GROUP_COMMIT_INTERVAL_MS after the oldest pending record
+ * was appended, even when no other command comes
+ * */
+struct wal {
+    FILE *file;
+    char *buffer;
+    uint32_t generation;
+    size_t pending;
+    struct timespec first_pending;
+};
+
+void dump_state(FILE *out, struct engine *engine);
+
+void bg_dump_init(struct bg_dump *dump);
+
+void bg_dump_reap(struct bg_dump *dump, int block);
+
+int bg_dump_start(struct bg_dump *dump, const char *path, struct engine *engine);
+
+int checkpoint_write(struct engine *engine, const char *path, uint32_t generation);
+
+int checkpoint_load(struct engine *engine, const char *path);
+
+void checkpoint_unmap(struct engine *engine);
+
+void checkpoint_load_startup(struct engine *engine, const char *path, int wal_enabled);
+
+int checkpoint(struct engine *engine, const char *path);
+
+struct wal *wal_open(struct engine *engine, const char *path);
+
+void wal_sync(struct wal *wal);
+
+void wal_commit(struct wal *wal, int force);
+
+long wal_commit_timeout(struct wal *wal);
+
+void wal_append(struct wal *wal, int op, char *name1, char *name2, char *name3);
+
+void wal_reset(struct wal *wal, uint32_t generation);
+
+void wal_close(struct wal *wal);
+
+#endif //PROVAFINALEAPI_PERSISTENCE_H
@@ -0,0 +1,115 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "report_rcu.h"
+
+void report_rcu_init(struct report_rcu *rcu) {
+    atomic_init(&rcu->current, NULL);
+    atomic_init(&rcu->epoch, 1);
+    atomic_init(&rcu->readers, 0);
+    for (int i = 0; i < REPORT_RCU_MAX_READERS; i++) {
+        atomic_init(&rcu->slots[i].epoch, REPORT_RCU_QUIESCENT);
+        atomic_init(&rcu->slots[i].used, 0);
+    }
+    rcu->retired = NULL;
+}
+
+/*
+ * Frees the retired versions no reader can still be reading: those
+ * retired before the oldest epoch a reader is in
+ * */
+static void report_rcu_reclaim(struct report_rcu *rcu) {
+    unsigned long long int oldest = ULLONG_MAX;
+    for (int i = 0; i < REPORT_RCU_MAX_READERS; i++) {
+        unsigned long long int epoch = atomic_load(&rcu->slots[i].epoch);
+        if (epoch != REPORT_RCU_QUIESCENT && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    struct report_version **link = &rcu->retired;
+    while (*link != NULL) {
+        struct report_version *version = *link;
+        if (version->retired_epoch < oldest) {
+            *link = version->retired_next;
+            free(version);
+        } else {
+            link = &version->retired_next;
+        }
+    }
+}
+
+/*
+ * Publishes a copy of text as the report at seq: readers that enter
+ * from now on get it, the ones already in keep the version they got
+ * */
+void report_rcu_publish(struct report_rcu *rcu, unsigned long long int seq, const char *text, size_t len) {
+    struct report_version *version = malloc(sizeof(struct report_version) + len);
+    if (version == NULL) {
+        exit(666);
+    }
+    version->seq = seq;
+    version->len = len;
+    version->retired_next = NULL;
+    version->retired_epoch = 0;
+    memcpy(version->text, text, len);
+    struct report_version *old = atomic_exchange(&rcu->current, version);
+    if (old != NULL) {
+        old->retired_epoch = atomic_fetch_add(&rcu->epoch, 1);
+        old->retired_next = rcu->retired;
+        rcu->retired = old;
+    }
+    if (rcu->retired != NULL) {
+        report_rcu_reclaim(rcu);
+    }
+}
+
+/*
+ * Claims a reader slot, to be passed to report_rcu_read_begin and
+ * report_rcu_read_end by the calling thread only: returns -1 if all
+ * REPORT_RCU_MAX_READERS slots are taken
+ * */
+int report_rcu_register(struct report_rcu *rcu) {
+    for (int i = 0; i < REPORT_RCU_MAX_READERS; i++) {
+        int expected = 0;
+        if (atomic_load_explicit(&rcu->slots[i].used, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong(&rcu->slots[i].used, &expected, 1)) {
+            atomic_fetch_add(&rcu->readers, 1);
+            return i;
+        }
+    }
+    return -1;
+}
+
+void report_rcu_unregister(struct report_rcu *rcu, int slot) {
+    atomic_store(&rcu->slots[slot].epoch, REPORT_RCU_QUIESCENT);
+    atomic_fetch_sub(&rcu->readers, 1);
+    atomic_store(&rcu->slots[slot].used, 0);
+}
+
+/*
+ * Returns the latest published version (NULL if there's none yet),
+ * which stays valid until report_rcu_read_end.
+ * The epoch is stored before current is loaded: if the writer
+ * replaces the version loaded here, it retires it at an epoch no
+ * lower than the stored one, and finds that epoch in the slot
+ * */
+const struct report_version *report_rcu_read_begin(struct report_rcu *rcu, int slot) {
+    atomic_store(&rcu->slots[slot].epoch, atomic_load(&rcu->epoch));
+    return atomic_load(&rcu->current);
+}
+
+void report_rcu_read_end(struct report_rcu *rcu, int slot) {
+    atomic_store_explicit(&rcu->slots[slot].epoch, REPORT_RCU_QUIESCENT, memory_order_release);
+}
+
+/*
+ * Frees every version: no reader may be left by now
+ * */
+void report_rcu_destroy(struct report_rcu *rcu) {
+    free(atomic_load(&rcu->current));
+    while (rcu->retired != NULL) {
+        struct report_version *next = rcu->retired->retired_next;
+        free(rcu->retired);
+        rcu->retired = next;
+    }
+}
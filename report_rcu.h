@@ -0,0 +1,86 @@
+#ifndef PROVAFINALEAPI_REPORT_RCU_H
+#define PROVAFINALEAPI_REPORT_RCU_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define REPORT_RCU_MAX_READERS 64
+
+/*
+ * Epoch of a reader that is not reading a version (epochs start at 1)
+ * */
+#define REPORT_RCU_QUIESCENT 0
+
+/*
+ * Slots are padded to a cache line, so readers entering and leaving
+ * don't bounce each other's lines
+ * */
+#define REPORT_RCU_SLOT_SIZE 64
+
+/*
+ * The text of a report as it was at operation sequence number seq:
+ * it's never written again once published, and it's only freed after
+ * every reader that could have seen it has left.
+ * retired_next and retired_epoch are only used by the writer, once
+ * the version has been replaced
+ * */
+struct report_version {
+    unsigned long long int seq;
+    size_t len;
+    struct report_version *retired_next;
+    unsigned long long int retired_epoch;
+    char text[];
+};
+
+struct report_reader_slot {
+    _Atomic unsigned long long int epoch;
+    atomic_int used;
+    char pad[REPORT_RCU_SLOT_SIZE - sizeof(unsigned long long int) - sizeof(int)];
+};
+
+/*
+ * Publication of reports to reader threads, with epoch based
+ * reclamation: a single writer swaps current for a new version and
+ * retires the old one at the epoch it then moves past; a reader
+ * stores the epoch it entered at in its slot before loading current,
+ * so a retired version can be freed as soon as no slot holds an
+ * epoch up to its retired_epoch.
+ * Readers never wait for the writer nor for each other, and the
+ * writer never waits for readers: it frees what it can on every
+ * publication and leaves the rest in retired
+ * */
+struct report_rcu {
+    _Atomic(struct report_version *) current;
+    _Atomic unsigned long long int epoch;
+    atomic_int readers;
+    struct report_reader_slot slots[REPORT_RCU_MAX_READERS];
+    struct report_version *retired;
+};
+
+void report_rcu_init(struct report_rcu *rcu);
+
+void report_rcu_publish(struct report_rcu *rcu, unsigned long long int seq, const char *text, size_t len);
+
+/*
+ * Returns the version last published by the writer (or NULL), only
+ * to be called by the writer itself
+ * */
+static inline struct report_version *report_rcu_latest(struct report_rcu *rcu) {
+    return atomic_load_explicit(&rcu->current, memory_order_relaxed);
+}
+
+static inline int report_rcu_has_readers(struct report_rcu *rcu) {
+    return atomic_load_explicit(&rcu->readers, memory_order_relaxed) > 0;
+}
+
+int report_rcu_register(struct report_rcu *rcu);
+
+void report_rcu_unregister(struct report_rcu *rcu, int slot);
+
+const struct report_version *report_rcu_read_begin(struct report_rcu *rcu, int slot);
+
+void report_rcu_read_end(struct report_rcu *rcu, int slot);
+
+void report_rcu_destroy(struct report_rcu *rcu);
+
+#endif //PROVAFINALEAPI_REPORT_RCU_H
@@ -0,0 +1,494 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "engine.h"
+#include "persistence.h"
+#include "slab.h"
+#include "text_protocol.h"
+
+#define DEFAULT_SOCKET_PATH "provafinaleapi.sock"
+#define LISTEN_BACKLOG 64
+#define MAX_EVENTS 64
+#define CLIENT_READ_SIZE 65536
+/*
+ * At most this many bytes are read from a client in a loop round,
+ * so that one client can't keep the others waiting
+ * */
+#define CLIENT_READ_BUDGET (4 * CLIENT_READ_SIZE)
+/*
+ * A client with this much output still to receive isn't read from
+ * until it takes some of it
+ * */
+#define CLIENT_MAX_PENDING_OUT (1024 * 1024)
+#define INITIAL_CLIENT_OUT_SIZE 4096
+#define CLIENT_OUT_GROWTH_FACTOR 2
+
+/*
+ * Build with -DWAL_ENABLED=1 to log every mutating command to
+ * DEFAULT_WAL_FILE and replay it at startup
+ * */
+#ifndef WAL_ENABLED
+#define WAL_ENABLED 0
+#endif
+
+/*
+ * Build with -DCOALESCE_ENABLED=1 to only apply the net effect of the
+ * addrel and delrel commands between two reports
+ * */
+#ifndef COALESCE_ENABLED
+#define COALESCE_ENABLED 0
+#endif
+
+/*
+ * Build with -DSLAB_STATS=1 to print the counters of the slab
+ * allocator on stderr before exiting
+ * */
+#ifndef SLAB_STATS
+#define SLAB_STATS 0
+#endif
+
+/*
+ * A connected client: data[data_pos, data_len) holds what was read
+ * from it and not run yet, in what it sent after its last complete
+ * line, out[out_sent, out_len) what it still has to receive.
+ * While reading is set, the client's origins queries see the state
+ * at read_seq, when it sent begin
+ * */
+struct client {
+    int fd;
+    char data[CLIENT_READ_SIZE];
+    size_t data_pos;
+    size_t data_len;
+    short int eof;
+    char in[MAX_LINE_LENGTH];
+    size_t in_len;
+    short int discarding;
+    char *out;
+    size_t out_len;
+    size_t out_sent;
+    size_t out_size;
+    short int closing;
+    short int reading;
+    unsigned long long int read_seq;
+};
+
+struct server {
+    int listen_fd;
+    int epoll_fd;
+    struct engine *engine;
+    struct bg_dump dump;
+};
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int signum) {
+    (void) signum;
+    stop = 1;
+}
+
+static void set_non_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        perror("fcntl");
+        exit(1);
+    }
+}
+
+struct client *client_new(int fd) {
+    struct client *client = malloc(sizeof(struct client));
+    if (client == NULL) {
+        exit(666);
+    }
+    client->fd = fd;
+    client->data_pos = 0;
+    client->data_len = 0;
+    client->eof = 0;
+    client->in_len = 0;
+    client->discarding = 0;
+    client->out = malloc(INITIAL_CLIENT_OUT_SIZE);
+    if (client->out == NULL) {
+        exit(666);
+    }
+    client->out_len = 0;
+    client->out_sent = 0;
+    client->out_size = INITIAL_CLIENT_OUT_SIZE;
+    client->closing = 0;
+    client->reading = 0;
+    client->read_seq = 0;
+    return client;
+}
+
+void client_destroy(struct server *server, struct client *client) {
+    if (client->reading) {
+        engine_read_end(server->engine, client->read_seq);
+    }
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    free(client->out);
+    free(client);
+}
+
+void client_queue(struct client *client, const char *data, size_t len) {
+    if (client->out_sent == client->out_len) {
+        client->out_sent = 0;
+        client->out_len = 0;
+    }
+    if (client->out_len + len > client->out_size) {
+        size_t new_size = client->out_size * CLIENT_OUT_GROWTH_FACTOR;
+        while (client->out_len + len > new_size) {
+            new_size *= CLIENT_OUT_GROWTH_FACTOR;
+        }
+        client->out = realloc(client->out, new_size);
+        if (client->out == NULL) {
+            exit(666);
+        }
+        client->out_size = new_size;
+    }
+    memcpy(client->out + client->out_len, data, len);
+    client->out_len += len;
+}
+
+static int client_blocked(struct client *client) {
+    return client->out_len - client->out_sent >= CLIENT_MAX_PENDING_OUT;
+}
+
+void client_feed(struct server *server, struct client *client);
+
+/*
+ * Sends as much of the pending output as the socket takes, running
+ * the lines held back while the client was blocked as room frees up.
+ * Then waits for the socket to become writable again if something
+ * is left, and to become readable only if the client isn't blocked.
+ * Returns 0 if the client has to be dropped
+ * */
+int client_flush(struct server *server, struct client *client) {
+    for (;;) {
+        while (client->out_sent < client->out_len) {
+            ssize_t n = write(client->fd, client->out + client->out_sent, client->out_len - client->out_sent);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                return 0;
+            }
+            client->out_sent += (size_t) n;
+        }
+        if (client->data_pos < client->data_len && !client->closing && !client_blocked(client)) {
+            client_feed(server, client);
+            continue;
+        }
+        break;
+    }
+    int pending = client->out_sent < client->out_len;
+    if (!pending && client->closing) {
+        return 0;
+    }
+    struct epoll_event event;
+    event.events = (pending ? EPOLLOUT : 0) |
+                   (client_blocked(client) || client->eof || client->closing ? 0 : EPOLLIN);
+    event.data.ptr = client;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+    return 1;
+}
+
+/*
+ * Runs one line sent by client: commands from every client go
+ * through the same engine in the order they're read, but each
+ * client only gets the reports it asked for
+ * */
+void handle_line(struct server *server, struct client *client, const char *line) {
+    char filtered_line[MAX_LINE_LENGTH];
+    char *params[MAX_PARAMS];
+    struct command command;
+    int n_par = text_tokenize(line, filtered_line, params);
+    if (text_parse_command(params, n_par, &command)) {
+        if (command.action == CMD_REPORT) {
+            size_t len;
+            const char *text = report(server->engine, &len);
+            client_queue(client, text, len);
+        } else {
+            run_command(server->engine, &command, NULL);
+        }
+    } else if (n_par > 0 && strcmp(params[0], ACTION_SNAPSHOT) == 0 && n_par <= 2) {
+        bg_dump_start(&server->dump, params[1] != NULL ? params[1] : DEFAULT_SNAPSHOT_FILE, server->engine);
+    } else if (n_par > 0 && strcmp(params[0], ACTION_CHECKPOINT) == 0 && n_par <= 2) {
+        char *path = params[1] != NULL ? params[1] : DEFAULT_CHECKPOINT_FILE;
+        if (checkpoint(server->engine, path) != 0) {
+            fprintf(stderr, "checkpoint: could not write %s\n", path);
+        }
+    } else if (n_par > 0 && strcmp(params[0], ACTION_BEGIN) == 0 && n_par == 1) {
+        if (client->reading) {
+            engine_read_end(server->engine, client->read_seq);
+        }
+        client->read_seq = engine_read_begin(server->engine);
+        client->reading = 1;
+    } else if (n_par > 0 && strcmp(params[0], ACTION_COMMIT) == 0 && n_par == 1) {
+        if (client->reading) {
+            engine_read_end(server->engine, client->read_seq);
+            client->reading = 0;
+        }
+    } else if (n_par > 0 && strcmp(params[0], ACTION_ORIGINS) == 0 && n_par == 3) {
+        size_t len;
+        unsigned long long int seq = client->reading ? client->read_seq : READ_LATEST;
+        const char *text = origins(server->engine, seq, params[1], params[2], &len);
+        client_queue(client, text, len);
+    } else if (n_par > 0 && strcmp(params[0], ACTION_LIST_ENT) == 0 && n_par <= 2) {
+        size_t len;
+        const char *text = list_ent(server->engine, params[1] != NULL ? params[1] : "", &len);
+        client_queue(client, text, len);
+    } else if (n_par > 0 && strcmp(params[0], ACTION_END) == 0) {
+        /*
+         * end only closes the connection, the state stays
+         * */
+        client->closing = 1;
+    }
+}
+
+/*
+ * Splits the data read from client into lines and runs them, stopping
+ * early if the client gets blocked by its pending output; lines longer
+ * than MAX_LINE_LENGTH are dropped
+ * */
+void client_feed(struct server *server, struct client *client) {
+    while (client->data_pos < client->data_len && !client->closing && !client_blocked(client)) {
+        char c = client->data[client->data_pos++];
+        if (c == '\n') {
+            if (!client->discarding) {
+                client->in[client->in_len] = '\0';
+                handle_line(server, client, client->in);
+            }
+            client->in_len = 0;
+            client->discarding = 0;
+        } else if (client->in_len + 1 >= MAX_LINE_LENGTH) {
+            client->discarding = 1;
+        } else if (!client->discarding) {
+            client->in[client->in_len++] = c;
+        }
+    }
+    if (client->eof && client->data_pos == client->data_len) {
+        client->closing = 1;
+    }
+}
+
+/*
+ * Reads at most CLIENT_READ_BUDGET bytes and runs them: what's left
+ * in the socket is read in the next rounds.
+ * Returns 0 if the client has to be dropped
+ * */
+int client_read(struct server *server, struct client *client) {
+    size_t budget = CLIENT_READ_BUDGET;
+    while (budget > 0 && !client->eof && !client->closing &&
+           client->data_pos == client->data_len && !client_blocked(client)) {
+        ssize_t n = read(client->fd, client->data, sizeof(client->data));
+        if (n > 0) {
+            client->data_pos = 0;
+            client->data_len = (size_t) n;
+            budget -= (size_t) n < budget ? (size_t) n : budget;
+            client_feed(server, client);
+        } else if (n == 0) {
+            /*
+             * Run the last line even without a newline
+             * */
+            client->eof = 1;
+            client->data_pos = 0;
+            client->data_len = 0;
+            if (client->in_len > 0 && !client->discarding) {
+                client->data[client->data_len++] = '\n';
+            }
+            client_feed(server, client);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            return 0;
+        }
+    }
+    return client_flush(server, client);
+}
+
+void accept_clients(struct server *server) {
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept");
+            }
+            return;
+        }
+        set_non_blocking(fd);
+        struct client *client = client_new(fd);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = client;
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(client->out);
+            free(client);
+        }
+    }
+}
+
+/*
+ * Returns how long epoll_wait can block: forever, unless logged
+ * commands are waiting for their group commit (addrel and delrel
+ * held back by coalescing aren't logged yet, but they're due too)
+ * */
+int server_timeout(struct server *server) {
+    struct engine *engine = server->engine;
+    if (engine->wal == NULL) {
+        return -1;
+    }
+    if (engine->batch != NULL && engine->batch->count > 0) {
+        return WAL_GROUP_COMMIT_INTERVAL_MS;
+    }
+    return (int) wal_commit_timeout(engine->wal);
+}
+
+/*
+ * Syncs the log once its group commit is due, so that records
+ * don't stay in the buffer while the server is idle
+ * */
+void server_commit(struct server *server, int timed_out) {
+    struct engine *engine = server->engine;
+    if (engine->wal == NULL) {
+        return;
+    }
+    if (timed_out) {
+        engine_flush(engine);
+    }
+    wal_commit(engine->wal, 0);
+}
+
+int server_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        exit(1);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        exit(1);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, LISTEN_BACKLOG) < 0) {
+        perror(path);
+        exit(1);
+    }
+    set_non_blocking(fd);
+    return fd;
+}
+
+/*
+ * Keeps the state in memory and serves text command streams from any
+ * number of local clients over a Unix domain socket:
+ *
+ * provafinaleapi_server [-c checkpoint] [socket path]
+ *
+ * Starts from checkpoint if one is given (or from the default one and
+ * the WAL when the WAL is enabled). Runs until SIGINT or SIGTERM
+ * */
+int main(int argc, char **argv) {
+    const char *checkpoint_path = NULL;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+        checkpoint_path = argv[2];
+        arg = 3;
+    }
+    if (argc > arg + 1) {
+        fprintf(stderr, "usage: provafinaleapi_server [-c checkpoint] [socket path]\n");
+        exit(1);
+    }
+    const char *path = argc > arg ? argv[arg] : DEFAULT_SOCKET_PATH;
+    struct server server;
+    struct epoll_event events[MAX_EVENTS];
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server.engine = engine_new();
+    bg_dump_init(&server.dump);
+    checkpoint_load_startup(server.engine, checkpoint_path, WAL_ENABLED);
+    if (WAL_ENABLED) {
+        wal_open(server.engine, DEFAULT_WAL_FILE);
+    }
+    if (COALESCE_ENABLED) {
+        engine_set_coalescing(server.engine, 1);
+    }
+
+    server.listen_fd = server_listen(path);
+    server.epoll_fd = epoll_create1(0);
+    if (server.epoll_fd < 0) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &event) < 0) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+
+    while (!stop) {
+        int n = epoll_wait(server.epoll_fd, events, MAX_EVENTS, server_timeout(&server));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            struct client *client = events[i].data.ptr;
+            if (client == NULL) {
+                accept_clients(&server);
+                continue;
+            }
+            int keep = 1;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                keep = client_read(&server, client);
+            } else if (events[i].events & EPOLLOUT) {
+                keep = client_flush(&server, client);
+            }
+            if (!keep) {
+                client_destroy(&server, client);
+            }
+        }
+        server_commit(&server, n == 0);
+        bg_dump_reap(&server.dump, 0);
+    }
+
+    /*
+     * Clients still connected are dropped: their descriptors
+     * go away with the process
+     * */
+    bg_dump_reap(&server.dump, 1);
+    close(server.epoll_fd);
+    close(server.listen_fd);
+    unlink(path);
+    if (SLAB_STATS) {
+        slab_print_stats(stderr);
+    }
+    engine_destroy(server.engine);
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include "slab.h"
+
+/*
+ * A freed block holds the next one of the free list of its class
+ * */
+struct slab_block {
+    struct slab_block *next;
+};
+
+struct slab_class {
+    struct slab_block *free_list;
+    char *cursor;
+    size_t left;
+    struct slab_stats stats;
+};
+
+static struct slab_class slab_classes[SLAB_CLASSES];
+
+/*
+ * Every chunk starts with a pointer to the previous one,
+ * so none of them is ever lost
+ * */
+static void *slab_chunks = NULL;
+
+static size_t slab_large_allocs = 0, slab_large_frees = 0;
+
+struct slab_region slab_regions[SLAB_MAX_REGIONS];
+int slab_region_count = 0;
+
+static inline size_t slab_class_of(size_t size) {
+    return size == 0 ? 0 : (size - 1) / SLAB_ALIGNMENT;
+}
+
+void *slab_alloc(size_t size) {
+    if (size > SLAB_MAX_SIZE) {
+        void *ptr = malloc(size);
+        if (ptr == NULL) {
+            exit(666);
+        }
+        slab_large_allocs++;
+        return ptr;
+    }
+    struct slab_class *class = &slab_classes[slab_class_of(size)];
+    size_t block_size = (slab_class_of(size) + 1) * SLAB_ALIGNMENT;
+    void *ptr;
+    if (class->free_list != NULL) {
+        ptr = class->free_list;
+        class->free_list = class->free_list->next;
+    } else {
+        if (class->left < block_size) {
+            char *chunk = malloc(SLAB_CHUNK_SIZE);
+            if (chunk == NULL) {
+                exit(666);
+            }
+            *(void **) chunk = slab_chunks;
+            slab_chunks = chunk;
+            class->cursor = chunk + SLAB_ALIGNMENT;
+            class->left = SLAB_CHUNK_SIZE - SLAB_ALIGNMENT;
+            class->stats.chunks++;
+        }
+        ptr = class->cursor;
+        class->cursor += block_size;
+        class->left -= block_size;
+    }
+    class->stats.allocs++;
+    class->stats.live++;
+    if (class->stats.live > class->stats.peak) {
+        class->stats.peak = class->stats.live;
+    }
+    return ptr;
+}
+
+/*
+ * size must be the one ptr was allocated with
+ * */
+void slab_free(void *ptr, size_t size) {
+    if (ptr == NULL || slab_in_region(ptr)) {
+        return;
+    }
+    if (size > SLAB_MAX_SIZE) {
+        free(ptr);
+        slab_large_frees++;
+        return;
+    }
+    struct slab_class *class = &slab_classes[slab_class_of(size)];
+    struct slab_block *block = ptr;
+    block->next = class->free_list;
+    class->free_list = block;
+    class->stats.frees++;
+    class->stats.live--;
+}
+
+void *slab_realloc(void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL) {
+        return slab_alloc(new_size);
+    }
+    if (slab_in_region(ptr)) {
+        void *new_ptr = slab_alloc(new_size);
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        return new_ptr;
+    }
+    if (old_size > SLAB_MAX_SIZE && new_size > SLAB_MAX_SIZE) {
+        ptr = realloc(ptr, new_size);
+        if (ptr == NULL) {
+            exit(666);
+        }
+        return ptr;
+    }
+    if (old_size <= SLAB_MAX_SIZE && new_size <= SLAB_MAX_SIZE &&
+        slab_class_of(old_size) == slab_class_of(new_size)) {
+        return ptr;
+    }
+    void *new_ptr = slab_alloc(new_size);
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    slab_free(ptr, old_size);
+    return new_ptr;
+}
+
+/*
+ * Returns 0 if the region was added, -1 if there's no room for it
+ * */
+int slab_add_region(void *base, size_t len) {
+    if (slab_region_count == SLAB_MAX_REGIONS) {
+        return -1;
+    }
+    slab_regions[slab_region_count].base = base;
+    slab_regions[slab_region_count].len = len;
+    slab_region_count++;
+    return 0;
+}
+
+/*
+ * Nothing may use the region in place anymore
+ * */
+void slab_remove_region(void *base) {
+    for (int i = 0; i < slab_region_count; i++) {
+        if (slab_regions[i].base == base) {
+            slab_regions[i] = slab_regions[--slab_region_count];
+            return;
+        }
+    }
+}
+
+/*
+ * Like realloc, for memory from malloc or from a region (which is
+ * copied out, old_size bytes of it at most)
+ * */
+void *slab_heap_realloc(void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL || !slab_in_region(ptr)) {
+        return realloc(ptr, new_size);
+    }
+    void *new_ptr = malloc(new_size);
+    if (new_ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return new_ptr;
+}
+
+/*
+ * Like free, for memory from malloc or from a region
+ * */
+void slab_heap_free(void *ptr) {
+    if (!slab_in_region(ptr)) {
+        free(ptr);
+    }
+}
+
+/*
+ * Sums the counters of all the size classes
+ * */
+void slab_get_stats(struct slab_stats *stats) {
+    memset(stats, 0, sizeof(struct slab_stats));
+    for (size_t i = 0; i < SLAB_CLASSES; i++) {
+        stats->allocs += slab_classes[i].stats.allocs;
+        stats->frees += slab_classes[i].stats.frees;
+        stats->live += slab_classes[i].stats.live;
+        stats->peak += slab_classes[i].stats.peak;
+        stats->chunks += slab_classes[i].stats.chunks;
+    }
+    stats->large_allocs = slab_large_allocs;
+    stats->large_frees = slab_large_frees;
+}
+
+void slab_print_stats(FILE *out) {
+    struct slab_stats total;
+    slab_get_stats(&total);
+    fprintf(out, "slab: %zu allocs, %zu frees, %zu live, %zu chunks (%zu KB), %zu large allocs, %zu large frees\n",
+            total.allocs, total.frees, total.live, total.chunks, total.chunks * SLAB_CHUNK_SIZE / 1024,
+            total.large_allocs, total.large_frees);
+    for (size_t i = 0; i < SLAB_CLASSES; i++) {
+        struct slab_stats *stats = &slab_classes[i].stats;
+        if (stats->allocs == 0) {
+            continue;
+        }
+        fprintf(out, "slab: %4zu bytes: %zu allocs, %zu frees, %zu live, %zu peak, %zu chunks\n",
+                (i + 1) * SLAB_ALIGNMENT, stats->allocs, stats->frees, stats->live, stats->peak, stats->chunks);
+    }
+}
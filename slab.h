@@ -0,0 +1,79 @@
+#ifndef PROVAFINALEAPI_SLAB_H
+#define PROVAFINALEAPI_SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Sizes are rounded up to a multiple of SLAB_ALIGNMENT, and every
+ * multiple up to SLAB_MAX_SIZE is a size class of its own
+ * */
+#define SLAB_ALIGNMENT 8
+#define SLAB_MAX_SIZE 256
+#define SLAB_CLASSES (SLAB_MAX_SIZE / SLAB_ALIGNMENT)
+#define SLAB_CHUNK_SIZE 65536
+
+/*
+ * Most regions of foreign memory (mapped checkpoints) there can be
+ * at once
+ * */
+#define SLAB_MAX_REGIONS 4
+
+/*
+ * Counters of the allocator, for every size class and in total.
+ * chunks are never given back, but a freed block goes to the free list
+ * of its class and is the first one given out again, so the memory
+ * held by a class never grows past its peak of live blocks
+ * */
+struct slab_stats {
+    size_t allocs;
+    size_t frees;
+    size_t live;
+    size_t peak;
+    size_t chunks;
+    size_t large_allocs;
+    size_t large_frees;
+};
+
+void *slab_alloc(size_t size);
+
+void *slab_realloc(void *ptr, size_t old_size, size_t new_size);
+
+void slab_free(void *ptr, size_t size);
+
+/*
+ * Regions of memory that tables use in place without owning it, like
+ * a mapped checkpoint: blocks in them are never handed to free or put
+ * in a free list, and growing one copies it out of the region
+ * */
+struct slab_region {
+    char *base;
+    size_t len;
+};
+
+extern struct slab_region slab_regions[SLAB_MAX_REGIONS];
+extern int slab_region_count;
+
+static inline int slab_in_region(const void *ptr) {
+    for (int i = 0; i < slab_region_count; i++) {
+        if ((uintptr_t) ptr - (uintptr_t) slab_regions[i].base < slab_regions[i].len) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int slab_add_region(void *base, size_t len);
+
+void slab_remove_region(void *base);
+
+void *slab_heap_realloc(void *ptr, size_t old_size, size_t new_size);
+
+void slab_heap_free(void *ptr);
+
+void slab_get_stats(struct slab_stats *stats);
+
+void slab_print_stats(FILE *out);
+
+#endif //PROVAFINALEAPI_SLAB_H
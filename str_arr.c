@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <string.h>
+#include "str_arr.h"
+#include "slab.h"
+#include "str_sort.h"
+
+struct str_arr *str_arr_new(size_t initial_size) {
+    struct str_arr *arr = malloc(sizeof(struct str_arr));
+    if (arr == NULL) {
+        exit(666);
+    }
+    if (initial_size == 0) {
+        initial_size = 1;
+    }
+    arr->array = malloc(sizeof(struct str_ref) * initial_size);
+    arr->heap = malloc(INITIAL_SA_HEAP_SIZE);
+    if (arr->array == NULL || arr->heap == NULL) {
+        exit(666);
+    }
+    arr->size = initial_size;
+    arr->next_free = 0;
+    arr->heap_len = 0;
+    arr->heap_size = INITIAL_SA_HEAP_SIZE;
+    arr->garbage = 0;
+    arr->sorted = 1;
+    return arr;
+}
+
+/*
+ * Makes room for size strings taking heap_size bytes in total
+ * ('\0' included), so that appending them never grows arr
+ * */
+void str_arr_reserve(struct str_arr *arr, size_t size, size_t heap_size) {
+    if (size > arr->size) {
+        arr->array = slab_heap_realloc(arr->array, sizeof(struct str_ref) * arr->size, sizeof(struct str_ref) * size);
+        if (arr->array == NULL) {
+            exit(666);
+        }
+        arr->size = size;
+    }
+    if (heap_size > arr->heap_size) {
+        arr->heap = slab_heap_realloc(arr->heap, arr->heap_size, heap_size);
+        if (arr->heap == NULL) {
+            exit(666);
+        }
+        arr->heap_size = heap_size;
+    }
+}
+
+void str_arr_append(struct str_arr *arr, const char *str) {
+    size_t len = strlen(str);
+    if (arr->next_free == arr->size) {
+        str_arr_reserve(arr, arr->size * SA_GROWTH_FACTOR, arr->heap_size);
+    }
+    if (arr->heap_len + len + 1 > arr->heap_size) {
+        size_t heap_size = arr->heap_size * SA_GROWTH_FACTOR;
+        while (arr->heap_len + len + 1 > heap_size) {
+            heap_size *= SA_GROWTH_FACTOR;
+        }
+        str_arr_reserve(arr, arr->size, heap_size);
+    }
+    if (arr->sorted && arr->next_free > 0 && strcmp(str_arr_get(arr, arr->next_free - 1), str) > 0) {
+        arr->sorted = 0;
+    }
+    memcpy(arr->heap + arr->heap_len, str, len + 1);
+    arr->array[arr->next_free].offset = arr->heap_len;
+    arr->array[arr->next_free].len = len;
+    arr->next_free++;
+    arr->heap_len += len + 1;
+}
+
+/*
+ * Removes the string at position i, moving the last string in its
+ * place (so callers tracking positions have to update the one of
+ * whatever is now at i): its bytes are left in the heap until there
+ * are enough of them to compact it
+ * */
+void str_arr_remove_at(struct str_arr *arr, size_t i) {
+    arr->garbage += arr->array[i].len + 1;
+    arr->array[i] = arr->array[--arr->next_free];
+    if (i < arr->next_free) {
+        arr->sorted = 0;
+    }
+    if (arr->garbage * 100 > arr->heap_len * SA_GARBAGE_THRESHOLD_PERCENTAGE) {
+        str_arr_compact(arr);
+    }
+}
+
+/*
+ * Sorts pointers to the strings in the heap, from which the refs are
+ * then rebuilt.
+ * Returns 1 if the strings were moved, 0 if they already were in order
+ * */
+int str_arr_sort(struct str_arr *arr) {
+    if (arr->sorted || arr->next_free < 2) {
+        arr->sorted = 1;
+        return 0;
+    }
+    char **strs = malloc(sizeof(char *) * arr->next_free);
+    if (strs == NULL) {
+        exit(666);
+    }
+    for (size_t i = 0; i < arr->next_free; i++) {
+        strs[i] = str_arr_get(arr, i);
+    }
+    str_sort(strs, arr->next_free);
+    for (size_t i = 0; i < arr->next_free; i++) {
+        arr->array[i].offset = (size_t) (strs[i] - arr->heap);
+        arr->array[i].len = strlen(strs[i]);
+    }
+    free(strs);
+    arr->sorted = 1;
+    return 1;
+}
+
+/*
+ * Rewrites the heap with just the strings still in arr, in the order
+ * they are in arr, so that going through arr reads the heap in order
+ * */
+void str_arr_compact(struct str_arr *arr) {
+    char *heap = malloc(arr->heap_size);
+    if (heap == NULL) {
+        exit(666);
+    }
+    size_t heap_len = 0;
+    for (size_t i = 0; i < arr->next_free; i++) {
+        memcpy(heap + heap_len, str_arr_get(arr, i), arr->array[i].len + 1);
+        arr->array[i].offset = heap_len;
+        heap_len += arr->array[i].len + 1;
+    }
+    slab_heap_free(arr->heap);
+    arr->heap = heap;
+    arr->heap_len = heap_len;
+    arr->garbage = 0;
+}
+
+void str_arr_destroy(struct str_arr *arr) {
+    slab_heap_free(arr->array);
+    slab_heap_free(arr->heap);
+    free(arr);
+}
@@ -0,0 +1,56 @@
+#ifndef PROVAFINALEAPI_STR_ARR_H
+#define PROVAFINALEAPI_STR_ARR_H
+
+#include <stddef.h>
+
+#define SA_GROWTH_FACTOR 2
+#define INITIAL_SA_HEAP_SIZE 4096
+/*
+ * The heap is compacted once removed strings take up
+ * more than this percentage of it
+ * */
+#define SA_GARBAGE_THRESHOLD_PERCENTAGE 50
+
+struct str_ref {
+    size_t offset;
+    size_t len;
+};
+
+/*
+ * Like a din_arr of strings, but the strings themselves are stored
+ * one after the other ('\0' terminated) in a single heap and the
+ * array only holds their offset and length.
+ * Pointers returned by str_arr_get are only valid until the next
+ * str_arr_append or str_arr_remove_at.
+ * sorted is set while the strings are known to be in ascending order
+ * */
+struct str_arr {
+    struct str_ref *array;
+    unsigned long int next_free;
+    size_t size;
+    char *heap;
+    size_t heap_len;
+    size_t heap_size;
+    size_t garbage;
+    short int sorted;
+};
+
+struct str_arr *str_arr_new(size_t initial_size);
+
+void str_arr_reserve(struct str_arr *arr, size_t size, size_t heap_size);
+
+void str_arr_append(struct str_arr *arr, const char *str);
+
+static inline char *str_arr_get(struct str_arr *arr, size_t i) {
+    return arr->heap + arr->array[i].offset;
+}
+
+void str_arr_remove_at(struct str_arr *arr, size_t i);
+
+int str_arr_sort(struct str_arr *arr);
+
+void str_arr_compact(struct str_arr *arr);
+
+void str_arr_destroy(struct str_arr *arr);
+
+#endif //PROVAFINALEAPI_STR_ARR_H
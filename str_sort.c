@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <string.h>
+#include "str_sort.h"
+
+static inline unsigned char str_byte(const char *str, size_t depth) {
+    return (unsigned char) str[depth];
+}
+
+static inline void str_swap(char **strs, size_t i, size_t j) {
+    char *tmp = strs[i];
+    strs[i] = strs[j];
+    strs[j] = tmp;
+}
+
+/*
+ * Sorts strings that are known to share their first depth bytes
+ * */
+static void str_insertion_sort(char **strs, size_t count, size_t depth) {
+    for (size_t i = 1; i < count; i++) {
+        char *cur = strs[i];
+        size_t j = i;
+        while (j > 0 && strcmp(cur + depth, strs[j - 1] + depth) < 0) {
+            strs[j] = strs[j - 1];
+            j--;
+        }
+        strs[j] = cur;
+    }
+}
+
+/*
+ * Returns how many bytes from depth all of strs have in common (the
+ * terminator excluded): groups of strings sharing a long prefix skip
+ * it in a single pass instead of a byte at a time
+ * */
+static size_t str_common_prefix(char **strs, size_t count, size_t depth) {
+    const char *first = strs[0] + depth;
+    size_t len = strlen(first);
+    for (size_t i = 1; i < count && len > 0; i++) {
+        const char *str = strs[i] + depth;
+        size_t j = 0;
+        while (j < len && str[j] == first[j]) {
+            j++;
+        }
+        len = j;
+    }
+    return len;
+}
+
+static unsigned char str_median(unsigned char a, unsigned char b, unsigned char c) {
+    if (a < b) {
+        return b < c ? b : (a < c ? c : a);
+    }
+    return a < c ? a : (b < c ? c : b);
+}
+
+/*
+ * Multikey quicksort (Bentley and Sedgewick): the strings are split
+ * in three by their byte at depth, and only those with the same byte
+ * as the pivot move on to the next one, so no byte is compared twice
+ * except within a partition
+ * */
+static void str_multikey_sort(char **strs, size_t count, size_t depth) {
+    while (count > STR_SORT_INSERTION_MAX) {
+        unsigned char pivot = str_median(str_byte(strs[0], depth), str_byte(strs[count / 2], depth),
+                                         str_byte(strs[count - 1], depth));
+        size_t lt = 0, i = 0, gt = count;
+        while (i < gt) {
+            unsigned char c = str_byte(strs[i], depth);
+            if (c < pivot) {
+                str_swap(strs, lt++, i++);
+            } else if (c > pivot) {
+                str_swap(strs, i, --gt);
+            } else {
+                i++;
+            }
+        }
+        if (lt == 0 && gt == count) {
+            if (pivot == '\0') {
+                return;
+            }
+            depth += str_common_prefix(strs, count, depth);
+            continue;
+        }
+        str_multikey_sort(strs, lt, depth);
+        if (pivot != '\0') {
+            str_multikey_sort(strs + lt, gt - lt, depth + 1);
+        }
+        strs += gt;
+        count -= gt;
+    }
+    str_insertion_sort(strs, count, depth);
+}
+
+/*
+ * MSD radix sort: the strings are counted and moved to their bucket for
+ * the byte at depth (read once, into bytes) through tmp, then every
+ * bucket is sorted from the next byte on. The strings in bucket 0
+ * have ended, so they're all the same
+ * */
+static void str_radix_sort(char **strs, size_t count, size_t depth, char **tmp, unsigned char *bytes) {
+    if (count < STR_SORT_RADIX_MIN) {
+        str_multikey_sort(strs, count, depth);
+        return;
+    }
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < count; i++) {
+        bytes[i] = str_byte(strs[i], depth);
+        counts[bytes[i]]++;
+    }
+    if (counts[bytes[0]] == count) {
+        if (bytes[0] != '\0') {
+            str_radix_sort(strs, count, depth + str_common_prefix(strs, count, depth), tmp, bytes);
+        }
+        return;
+    }
+    size_t starts[256], pos = 0;
+    for (int c = 0; c < 256; c++) {
+        starts[c] = pos;
+        pos += counts[c];
+    }
+    for (size_t i = 0; i < count; i++) {
+        tmp[starts[bytes[i]]++] = strs[i];
+    }
+    memcpy(strs, tmp, sizeof(char *) * count);
+    pos = counts[0];
+    for (int c = 1; c < 256; c++) {
+        if (counts[c] > 1) {
+            str_radix_sort(strs + pos, counts[c], depth + 1, tmp, bytes);
+        }
+        pos += counts[c];
+    }
+}
+
+/*
+ * Sorts strs in ascending order (the one of strcmp)
+ * */
+void str_sort(char **strs, size_t count) {
+    if (count < STR_SORT_RADIX_MIN) {
+        str_multikey_sort(strs, count, 0);
+        return;
+    }
+    char **tmp = malloc(sizeof(char *) * count);
+    unsigned char *bytes = malloc(count);
+    if (tmp == NULL || bytes == NULL) {
+        exit(666);
+    }
+    str_radix_sort(strs, count, 0, tmp, bytes);
+    free(tmp);
+    free(bytes);
+}
@@ -0,0 +1,16 @@
+#ifndef PROVAFINALEAPI_STR_SORT_H
+#define PROVAFINALEAPI_STR_SORT_H
+
+#include <stddef.h>
+
+/*
+ * Arrays with at least this many strings are split by radix on their
+ * next byte, smaller ones by multikey quicksort, and the smallest
+ * ones by insertion
+ * */
+#define STR_SORT_RADIX_MIN 1024
+#define STR_SORT_INSERTION_MAX 16
+
+void str_sort(char **strs, size_t count);
+
+#endif //PROVAFINALEAPI_STR_SORT_H
@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "text_protocol.h"
+
+int text_tokenize(const char *line, char *filtered_line, char **params) {
+    int n_par = 0;
+    size_t filt_len = 0;
+    for (size_t i = 0; line[i] != '\0'; i++) {
+        if (line[i] != '\"' && line[i] != '\n' && line[i] != '\r') {
+            filtered_line[filt_len] = line[i];
+            filt_len++;
+        }
+    }
+    filtered_line[filt_len] = '\0';
+    memset(params, 0, MAX_PARAMS * sizeof(char *));
+    char *token = strtok(filtered_line, " ");
+    while (token != NULL) {
+        if (n_par >= MAX_PARAMS) {
+            return -1;
+        }
+        params[n_par] = token;
+        token = strtok(NULL, " ");
+        n_par++;
+    }
+    return n_par;
+}
+
+int text_parse_command(char **params, int n_par, struct command *command) {
+    if (n_par == 0) {
+        return 0;
+    }
+    command->action = 0;
+    if (strcmp(params[0], ACTION_ADD_ENT) == 0 && n_par == 2) {
+        command->action = CMD_ADD_ENT;
+    } else if (strcmp(params[0], ACTION_DEL_ENT) == 0 && n_par == 2) {
+        command->action = CMD_DEL_ENT;
+    } else if (strcmp(params[0], ACTION_ADD_REL) == 0 && n_par == 4) {
+        command->action = CMD_ADD_REL;
+    } else if (strcmp(params[0], ACTION_DEL_REL) == 0 && n_par == 4) {
+        command->action = CMD_DEL_REL;
+    } else if (strcmp(params[0], ACTION_REPORT) == 0 && n_par == 1) {
+        command->action = CMD_REPORT;
+    } else {
+        return 0;
+    }
+    command->params[0] = params[1];
+    command->params[1] = params[2];
+    command->params[2] = params[3];
+    return 1;
+}
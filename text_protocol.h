@@ -0,0 +1,40 @@
+#ifndef PROVAFINALEAPI_TEXT_PROTOCOL_H
+#define PROVAFINALEAPI_TEXT_PROTOCOL_H
+
+#include "engine.h"
+
+#define MAX_LINE_LENGTH 200
+
+#define ACTION_ADD_ENT "addent"
+#define ACTION_DEL_ENT "delent"
+#define ACTION_ADD_REL "addrel"
+#define ACTION_DEL_REL "delrel"
+#define ACTION_REPORT "report"
+#define ACTION_SNAPSHOT "snapshot"
+#define ACTION_CHECKPOINT "checkpoint"
+#define ACTION_END "end"
+#define ACTION_BEGIN "begin"
+#define ACTION_COMMIT "commit"
+#define ACTION_ORIGINS "origins"
+#define ACTION_LIST_ENT "list_ent"
+
+#define MAX_PARAM_LENGTH 40
+#define MAX_PARAMS 4
+
+/*
+ * Splits line into at most MAX_PARAMS space separated tokens, dropping
+ * quotes and line terminators. The tokens are stored into
+ * filtered_line (which must be as long as line) and pointed to by
+ * params; unused params are set to NULL.
+ * Returns the number of tokens, -1 if there are too many
+ * */
+int text_tokenize(const char *line, char *filtered_line, char **params);
+
+/*
+ * Fills command from the tokens of a line if they are a well formed
+ * engine command (addent, delent, addrel, delrel or report).
+ * Returns 1 if they are, 0 otherwise
+ * */
+int text_parse_command(char **params, int n_par, struct command *command);
+
+#endif //PROVAFINALEAPI_TEXT_PROTOCOL_H
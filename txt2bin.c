@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "binary_protocol.h"
+#include "text_protocol.h"
+
+#define INITIAL_NAME_IDS_SIZE 131072
+
+/*
+ * Converts a text command stream to the binary format of
+ * binary_protocol.h:
+ *
+ * txt2bin [--inline] [input [output]]
+ *
+ * input defaults to input.txt and output to input.bin. Names are
+ * declared once and then referred to by id, unless --inline is given.
+ * Commands the engine doesn't know are dropped
+ * */
+int main(int argc, char **argv) {
+    int inline_names = 0;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--inline") == 0) {
+        inline_names = 1;
+        arg++;
+    }
+    const char *in_path = arg < argc ? argv[arg++] : "input.txt";
+    const char *out_path = arg < argc ? argv[arg++] : "input.bin";
+    FILE *in = fopen(in_path, "r");
+    FILE *out = fopen(out_path, "wb");
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "txt2bin: could not open %s\n", in == NULL ? in_path : out_path);
+        exit(1);
+    }
+
+    /*
+     * name_ids maps every name seen so far to its id
+     * */
+    struct hash_table *name_ids = ht_new(INITIAL_NAME_IDS_SIZE);
+    uint32_t next_id = 0;
+    char line[MAX_LINE_LENGTH], filtered_line[MAX_LINE_LENGTH];
+    char *params[MAX_PARAMS];
+
+    bin_write_header(out);
+    while (fgets(line, MAX_LINE_LENGTH, in)) {
+        struct command command;
+        int n_par = text_tokenize(line, filtered_line, params);
+        if (n_par > 0 && strcmp(params[0], ACTION_END) == 0) {
+            break;
+        }
+        if (!text_parse_command(params, n_par, &command)) {
+            continue;
+        }
+        int action = command.action;
+
+        if (inline_names) {
+            bin_write_inline_command(out, action, params + 1, n_par - 1);
+            continue;
+        }
+        uint32_t ids[MAX_PARAMS];
+        for (int i = 1; i < n_par; i++) {
+            uint32_t *id = ht_get(name_ids, params[i]);
+            if (id == NULL) {
+                id = malloc(sizeof(uint32_t));
+                if (id == NULL) {
+                    exit(666);
+                }
+                *id = next_id++;
+                ht_insert(name_ids, params[i], id);
+                bin_write_declare(out, *id, params[i]);
+            }
+            ids[i - 1] = *id;
+        }
+        bin_write_command(out, action, ids, n_par - 1);
+    }
+    bin_write_end(out);
+
+    ht_destroy(name_ids);
+    fclose(in);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "txt2bin: could not write %s\n", out_path);
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,473 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "uring_io.h"
+
+#ifdef HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/*
+ * Minimal io_uring ring, used through the raw system calls
+ * */
+struct uring {
+    int fd;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+};
+
+/*
+ * io_uring_setup works since Linux 5.1, but IORING_OP_READ and
+ * IORING_OP_WRITE only came with 5.6, together with the probe: on
+ * the kernels in between every completion would fail with -EINVAL
+ * */
+static int uring_supports_read_write(int fd) {
+    size_t len = sizeof(struct io_uring_probe) + (IORING_OP_WRITE + 1) * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    if (probe == NULL) {
+        exit(666);
+    }
+    int supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_WRITE + 1) == 0 &&
+                    probe->last_op >= IORING_OP_WRITE &&
+                    (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                    (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+/*
+ * Returns 0 on success, -1 if io_uring is not available
+ * */
+static int uring_init(struct uring *ring, unsigned int entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    if (!uring_supports_read_write(ring->fd)) {
+        close(ring->fd);
+        return -1;
+    }
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(ring->fd);
+            return -1;
+        }
+    }
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_len);
+        }
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(ring->fd);
+        return -1;
+    }
+    ring->sq_tail = (unsigned int *) ((char *) ring->sq_ptr + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *) ((char *) ring->sq_ptr + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *) ((char *) ring->sq_ptr + params.sq_off.array);
+    ring->cq_head = (unsigned int *) ((char *) ring->cq_ptr + params.cq_off.head);
+    ring->cq_tail = (unsigned int *) ((char *) ring->cq_ptr + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *) ((char *) ring->cq_ptr + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ptr + params.cq_off.cqes);
+    return 0;
+}
+
+static void uring_exit(struct uring *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+/*
+ * Submits a read or write of len bytes of buf at offset of fd,
+ * tagged with user_data. Returns 0 on success, -1 on error
+ * */
+static int uring_submit(struct uring *ring, int opcode, int fd, void *buf, unsigned int len,
+                        off_t offset, unsigned long long int user_data) {
+    unsigned int tail = *ring->sq_tail;
+    unsigned int index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char) opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long int) (uintptr_t) buf;
+    sqe->len = len;
+    sqe->off = (unsigned long long int) offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Waits for the next completion and stores its tag and result.
+ * Returns 0 on success, -1 on error
+ * */
+static int uring_wait(struct uring *ring, unsigned long long int *user_data, int *res) {
+    unsigned int head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR) {
+            return -1;
+        }
+    }
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+#define URING_IDLE 0
+#define URING_IN_FLIGHT 1
+#define URING_DONE 2
+
+/*
+ * Buffers are filled (by the kernel for reads, by the writer for
+ * writes) in round robin order: current is the one being consumed or
+ * filled. Regular files get explicit offsets so that all buffers can
+ * be in flight at once; pipes and terminals keep one in flight, since
+ * their reads and writes have to complete in order.
+ * If the ring fails to read or write (some files don't support it),
+ * the stream falls back to plain read/write from that point on
+ * */
+struct uring_stream {
+    struct uring ring;
+    int fd;
+    int writing;
+    int depth;
+    off_t offset;
+    char *buffers[URING_QUEUE_DEPTH];
+    int states[URING_QUEUE_DEPTH];
+    int results[URING_QUEUE_DEPTH];
+    size_t lens[URING_QUEUE_DEPTH];
+    off_t offsets[URING_QUEUE_DEPTH];
+    int current;
+    size_t pos;
+    int eof;
+    int error;
+    int fallback;
+};
+
+static off_t uring_stream_next_offset(struct uring_stream *stream, size_t len) {
+    if (stream->depth == 1) {
+        return -1;
+    }
+    off_t offset = stream->offset;
+    stream->offset += (off_t) len;
+    return offset;
+}
+
+/*
+ * Waits until buffer i is not in flight anymore
+ * */
+static void uring_stream_wait(struct uring_stream *stream, int i) {
+    while (stream->states[i] == URING_IN_FLIGHT) {
+        unsigned long long int user_data;
+        int res;
+        if (uring_wait(&stream->ring, &user_data, &res) != 0) {
+            stream->error = 1;
+            stream->states[i] = URING_IDLE;
+            return;
+        }
+        stream->states[user_data] = URING_DONE;
+        stream->results[user_data] = res;
+    }
+}
+
+static void uring_stream_submit_read(struct uring_stream *stream, int i) {
+    if (stream->eof || stream->fallback) {
+        return;
+    }
+    stream->offsets[i] = uring_stream_next_offset(stream, URING_BUFFER_SIZE);
+    if (uring_submit(&stream->ring, IORING_OP_READ, stream->fd, stream->buffers[i], URING_BUFFER_SIZE,
+                     stream->offsets[i], (unsigned long long int) i) != 0) {
+        stream->states[i] = URING_DONE;
+        stream->results[i] = -errno;
+        return;
+    }
+    stream->states[i] = URING_IN_FLIGHT;
+}
+
+/*
+ * Gives up on the ring after the read of buffer i failed: the buffers
+ * read ahead of it are dropped and a regular file is rewound to where
+ * i starts, so that plain reads go on from there
+ * */
+static void uring_stream_read_fall_back(struct uring_stream *stream, int i) {
+    stream->fallback = 1;
+    for (int j = 0; j < stream->depth; j++) {
+        uring_stream_wait(stream, j);
+        stream->states[j] = URING_IDLE;
+    }
+    if (stream->offsets[i] >= 0 && lseek(stream->fd, stream->offsets[i], SEEK_SET) < 0) {
+        stream->error = 1;
+    }
+}
+
+static ssize_t uring_stream_read(void *cookie, char *buf, size_t size) {
+    struct uring_stream *stream = cookie;
+    size_t copied = 0;
+    while (copied < size && !stream->error && !stream->fallback) {
+        int i = stream->current;
+        uring_stream_wait(stream, i);
+        if (stream->states[i] != URING_DONE) {
+            break;
+        }
+        if (stream->results[i] < 0) {
+            uring_stream_read_fall_back(stream, i);
+            break;
+        }
+        size_t available = (size_t) stream->results[i] - stream->pos;
+        if (stream->results[i] == 0) {
+            stream->eof = 1;
+            break;
+        }
+        size_t n = available < size - copied ? available : size - copied;
+        memcpy(buf + copied, stream->buffers[i] + stream->pos, n);
+        copied += n;
+        stream->pos += n;
+        if (stream->pos == (size_t) stream->results[i]) {
+            /*
+             * A short read of a regular file means end of file: the
+             * reads after it may only return nothing
+             * */
+            if (stream->depth > 1 && stream->results[i] < URING_BUFFER_SIZE) {
+                stream->eof = 1;
+            }
+            stream->states[i] = URING_IDLE;
+            stream->pos = 0;
+            uring_stream_submit_read(stream, i);
+            stream->current = (i + 1) % stream->depth;
+            if (stream->eof) {
+                break;
+            }
+        }
+        /*
+         * Hand back what we have rather than wait for the next buffer
+         * */
+        if (copied > 0 && stream->states[stream->current] == URING_IN_FLIGHT) {
+            break;
+        }
+    }
+    if (stream->error && copied == 0) {
+        return -1;
+    }
+    if (stream->fallback && copied == 0) {
+        ssize_t n;
+        while ((n = read(stream->fd, buf, size)) < 0 && errno == EINTR) {
+        }
+        return n;
+    }
+    return (ssize_t) copied;
+}
+
+/*
+ * Writes buffer i from written on with plain system calls, at the
+ * buffer's own offset for regular files
+ * */
+static void uring_stream_write_sync(struct uring_stream *stream, int i, size_t written) {
+    while (!stream->error && written < stream->lens[i]) {
+        ssize_t n;
+        if (stream->offsets[i] < 0) {
+            n = write(stream->fd, stream->buffers[i] + written, stream->lens[i] - written);
+        } else {
+            n = pwrite(stream->fd, stream->buffers[i] + written, stream->lens[i] - written,
+                       stream->offsets[i] + (off_t) written);
+        }
+        if (n < 0) {
+            if (errno != EINTR) {
+                stream->error = 1;
+            }
+        } else {
+            written += (size_t) n;
+        }
+    }
+}
+
+/*
+ * Writes out whatever the kernel left of buffer i synchronously
+ * (short writes are rare, and only happen on errors or full disks).
+ * If the ring failed to write it at all, the rest of the stream is
+ * written without the ring
+ * */
+static void uring_stream_complete_write(struct uring_stream *stream, int i) {
+    uring_stream_wait(stream, i);
+    if (stream->states[i] == URING_DONE) {
+        size_t written = 0;
+        if (stream->results[i] < 0) {
+            stream->fallback = 1;
+        } else {
+            written = (size_t) stream->results[i];
+        }
+        uring_stream_write_sync(stream, i, written);
+    }
+    stream->states[i] = URING_IDLE;
+    stream->lens[i] = 0;
+}
+
+static void uring_stream_submit_write(struct uring_stream *stream, int i) {
+    stream->offsets[i] = uring_stream_next_offset(stream, stream->lens[i]);
+    if (stream->fallback ||
+        uring_submit(&stream->ring, IORING_OP_WRITE, stream->fd, stream->buffers[i],
+                     (unsigned int) stream->lens[i], stream->offsets[i], (unsigned long long int) i) != 0) {
+        stream->fallback = 1;
+        uring_stream_write_sync(stream, i, 0);
+        stream->lens[i] = 0;
+    } else {
+        stream->states[i] = URING_IN_FLIGHT;
+    }
+    stream->current = (i + 1) % stream->depth;
+    uring_stream_complete_write(stream, stream->current);
+}
+
+static ssize_t uring_stream_write(void *cookie, const char *buf, size_t size) {
+    struct uring_stream *stream = cookie;
+    size_t copied = 0;
+    while (copied < size && !stream->error) {
+        int i = stream->current;
+        size_t n = URING_BUFFER_SIZE - stream->lens[i];
+        if (n > size - copied) {
+            n = size - copied;
+        }
+        memcpy(stream->buffers[i] + stream->lens[i], buf + copied, n);
+        stream->lens[i] += n;
+        copied += n;
+        if (stream->lens[i] == URING_BUFFER_SIZE) {
+            uring_stream_submit_write(stream, i);
+        }
+    }
+    return stream->error ? -1 : (ssize_t) copied;
+}
+
+static int uring_stream_close(void *cookie) {
+    struct uring_stream *stream = cookie;
+    if (stream->writing && stream->lens[stream->current] > 0 && !stream->error) {
+        uring_stream_submit_write(stream, stream->current);
+    }
+    for (int i = 0; i < stream->depth; i++) {
+        if (stream->writing && stream->states[i] != URING_IDLE) {
+            uring_stream_complete_write(stream, i);
+        } else {
+            uring_stream_wait(stream, i);
+        }
+        free(stream->buffers[i]);
+    }
+    int ret = stream->error ? EOF : 0;
+    uring_exit(&stream->ring);
+    free(stream);
+    return ret;
+}
+
+static FILE *uring_stream_open(int fd, const char *mode) {
+    int reading = mode[0] == 'r';
+    struct uring_stream *stream = calloc(1, sizeof(struct uring_stream));
+    if (stream == NULL) {
+        exit(666);
+    }
+    if (uring_init(&stream->ring, URING_QUEUE_DEPTH) != 0) {
+        free(stream);
+        return NULL;
+    }
+    struct stat st;
+    stream->fd = fd;
+    stream->writing = !reading;
+    stream->depth = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? URING_QUEUE_DEPTH : 1;
+    stream->offset = lseek(fd, 0, SEEK_CUR);
+    if (stream->offset < 0) {
+        stream->offset = 0;
+    }
+    for (int i = 0; i < stream->depth; i++) {
+        stream->buffers[i] = malloc(URING_BUFFER_SIZE);
+        if (stream->buffers[i] == NULL) {
+            exit(666);
+        }
+    }
+    if (reading) {
+        for (int i = 0; i < stream->depth; i++) {
+            uring_stream_submit_read(stream, i);
+        }
+    }
+    cookie_io_functions_t functions = {
+            reading ? uring_stream_read : NULL,
+            reading ? NULL : uring_stream_write,
+            NULL,
+            uring_stream_close
+    };
+    FILE *file = fopencookie(stream, mode, functions);
+    if (file == NULL) {
+        uring_stream_close(stream);
+        return NULL;
+    }
+    return file;
+}
+
+#endif
+
+FILE *uring_fdopen(int fd, const char *mode) {
+#ifdef HAVE_IO_URING
+    FILE *file = uring_stream_open(fd, mode);
+    if (file != NULL) {
+        return file;
+    }
+#endif
+    /*
+     * Fall back to plain read/write
+     * */
+    int copy = dup(fd);
+    if (copy < 0) {
+        return NULL;
+    }
+    return fdopen(copy, mode);
+}
@@ -0,0 +1,19 @@
+#ifndef PROVAFINALEAPI_URING_IO_H
+#define PROVAFINALEAPI_URING_IO_H
+
+#include <stdio.h>
+
+#define URING_QUEUE_DEPTH 4
+#define URING_BUFFER_SIZE 65536
+
+/*
+ * Returns a stream reading (mode "r") or writing (mode "w") fd.
+ * When built with HAVE_IO_URING and the kernel allows it, reads are
+ * issued through io_uring URING_QUEUE_DEPTH buffers ahead of the
+ * reader and writes are submitted without waiting for them to
+ * complete; otherwise it's a plain stdio stream on a copy of fd.
+ * fd itself is never closed by fclose
+ * */
+FILE *uring_fdopen(int fd, const char *mode);
+
+#endif //PROVAFINALEAPI_URING_IO_H
@@ -0,0 +1,87 @@
+#ifndef PROVAFINALEAPI_VEC_H
+#define PROVAFINALEAPI_VEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "slab.h"
+
+#define INITIAL_VEC_SIZE 4
+#define VEC_GROWTH_FACTOR 2
+
+/*
+ * Declares struct name, a growable array of type holding the elements
+ * themselves (unlike din_arr, which holds void pointers), and its
+ * functions, named name_init, name_push and so on.
+ * They're all static inline, so every vector gets code specialized for
+ * its type, and elements are compared with == (so type has to be a
+ * scalar or a pointer for name_remove).
+ * The struct is meant to be embedded in its owner, not allocated
+ * on its own. items may be in a slab region (a loaded checkpoint),
+ * which is why it grows and goes with slab_heap_realloc and
+ * slab_heap_free
+ * */
+#define VEC_DEFINE(name, type)                                                  \
+struct name {                                                                   \
+    type *items;                                                                \
+    size_t len;                                                                 \
+    size_t size;                                                                \
+};                                                                              \
+                                                                                \
+static inline void name##_init(struct name *vec, size_t initial_size) {         \
+    vec->size = initial_size > 0 ? initial_size : INITIAL_VEC_SIZE;             \
+    vec->items = malloc(sizeof(type) * vec->size);                              \
+    if (vec->items == NULL) {                                                   \
+        exit(666);                                                              \
+    }                                                                           \
+    vec->len = 0;                                                               \
+}                                                                               \
+                                                                                \
+static inline void name##_push(struct name *vec, type elem) {                   \
+    if (vec->len == vec->size) {                                                \
+        size_t old_size = vec->size;                                            \
+        vec->size *= VEC_GROWTH_FACTOR;                                         \
+        vec->items = slab_heap_realloc(vec->items, sizeof(type) * old_size,     \
+                                       sizeof(type) * vec->size);               \
+        if (vec->items == NULL) {                                               \
+            exit(666);                                                          \
+        }                                                                       \
+    }                                                                           \
+    vec->items[vec->len++] = elem;                                              \
+}                                                                               \
+                                                                                \
+static inline type name##_pop(struct name *vec) {                               \
+    return vec->items[--vec->len];                                              \
+}                                                                               \
+                                                                                \
+/*                                                                              \
+ * Moves the last element where the removed one was                            \
+ * */                                                                           \
+static inline void name##_remove_at(struct name *vec, size_t i) {               \
+    vec->items[i] = vec->items[--vec->len];                                     \
+}                                                                               \
+                                                                                \
+/*                                                                              \
+ * Returns 0 if elem was not in vec, 1 otherwise                                \
+ * */                                                                           \
+static inline int name##_remove(struct name *vec, type elem) {                  \
+    for (size_t i = 0; i < vec->len; i++) {                                     \
+        if (vec->items[i] == elem) {                                            \
+            name##_remove_at(vec, i);                                           \
+            return 1;                                                           \
+        }                                                                       \
+    }                                                                           \
+    return 0;                                                                   \
+}                                                                               \
+                                                                                \
+static inline void name##_clear(struct name *vec) {                             \
+    vec->len = 0;                                                               \
+}                                                                               \
+                                                                                \
+static inline void name##_destroy(struct name *vec) {                           \
+    slab_heap_free(vec->items);                                                 \
+}
+
+VEC_DEFINE(u32_vec, uint32_t)
+
+#endif //PROVAFINALEAPI_VEC_H
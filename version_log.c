@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <string.h>
+#include "version_log.h"
+
+struct version_log *version_log_new(void) {
+    struct version_log *log = malloc(sizeof(struct version_log));
+    if (log == NULL) {
+        exit(666);
+    }
+    log->records = malloc(sizeof(struct version_record) * INITIAL_VERSION_LOG_SIZE);
+    log->readers = malloc(sizeof(unsigned long long int) * INITIAL_READERS_SIZE);
+    if (log->records == NULL || log->readers == NULL) {
+        exit(666);
+    }
+    log->start = 0;
+    log->end = 0;
+    log->size = INITIAL_VERSION_LOG_SIZE;
+    log->readers_count = 0;
+    log->readers_size = INITIAL_READERS_SIZE;
+    return log;
+}
+
+/*
+ * Records are appended in sequence number order, so they're always
+ * sorted by it
+ * */
+void version_log_record(struct version_log *log, unsigned long long int seq, int added,
+                        const char *rel, const char *dest, const char *origin) {
+    if (log->end == log->size) {
+        /*
+         * Reuse the room left by dropped records before growing
+         * */
+        if (log->start > log->size / 2) {
+            memmove(log->records, log->records + log->start,
+                    sizeof(struct version_record) * (log->end - log->start));
+            log->end -= log->start;
+            log->start = 0;
+        } else {
+            log->size *= VERSION_LOG_GROWTH_FACTOR;
+            log->records = realloc(log->records, sizeof(struct version_record) * log->size);
+            if (log->records == NULL) {
+                exit(666);
+            }
+        }
+    }
+    size_t rel_len = strlen(rel) + 1, dest_len = strlen(dest) + 1, origin_len = strlen(origin) + 1;
+    struct version_record *record = &log->records[log->end++];
+    record->seq = seq;
+    record->added = added;
+    record->names = malloc(rel_len + dest_len + origin_len);
+    if (record->names == NULL) {
+        exit(666);
+    }
+    memcpy(record->names, rel, rel_len);
+    memcpy(record->names + rel_len, dest, dest_len);
+    memcpy(record->names + rel_len + dest_len, origin, origin_len);
+}
+
+const char *version_record_rel(struct version_record *record) {
+    return record->names;
+}
+
+const char *version_record_dest(struct version_record *record) {
+    return record->names + strlen(record->names) + 1;
+}
+
+const char *version_record_origin(struct version_record *record) {
+    const char *dest = version_record_dest(record);
+    return dest + strlen(dest) + 1;
+}
+
+void version_log_open(struct version_log *log, unsigned long long int seq) {
+    if (log->readers_count == log->readers_size) {
+        log->readers_size *= VERSION_LOG_GROWTH_FACTOR;
+        log->readers = realloc(log->readers, sizeof(unsigned long long int) * log->readers_size);
+        if (log->readers == NULL) {
+            exit(666);
+        }
+    }
+    log->readers[log->readers_count++] = seq;
+}
+
+/*
+ * Closes a view opened at seq and drops the records that no view
+ * still open can undo
+ * */
+void version_log_close(struct version_log *log, unsigned long long int seq) {
+    for (size_t i = 0; i < log->readers_count; i++) {
+        if (log->readers[i] == seq) {
+            log->readers[i] = log->readers[--log->readers_count];
+            break;
+        }
+    }
+    unsigned long long int oldest = 0;
+    for (size_t i = 0; i < log->readers_count; i++) {
+        if (i == 0 || log->readers[i] < oldest) {
+            oldest = log->readers[i];
+        }
+    }
+    while (log->start < log->end && (log->readers_count == 0 || log->records[log->start].seq <= oldest)) {
+        free(log->records[log->start].names);
+        log->start++;
+    }
+    if (log->start == log->end) {
+        log->start = 0;
+        log->end = 0;
+    }
+}
+
+void version_log_destroy(struct version_log *log) {
+    for (size_t i = log->start; i < log->end; i++) {
+        free(log->records[i].names);
+    }
+    free(log->records);
+    free(log->readers);
+    free(log);
+}
@@ -0,0 +1,61 @@
+#ifndef PROVAFINALEAPI_VERSION_LOG_H
+#define PROVAFINALEAPI_VERSION_LOG_H
+
+#include <stddef.h>
+
+#define INITIAL_VERSION_LOG_SIZE 1024
+#define VERSION_LOG_GROWTH_FACTOR 2
+#define INITIAL_READERS_SIZE 16
+
+/*
+ * An "arrow" that was added or deleted by the command with operation
+ * sequence number seq. Names are copied one after the other in names
+ * (relationship, destination, origin), since entity ids are reused
+ * once entities are deleted
+ * */
+struct version_record {
+    unsigned long long int seq;
+    int added;
+    char *names;
+};
+
+/*
+ * Undo log of the changes to the "arrows", kept only while read views
+ * are open: a view opened at sequence number S sees the current state
+ * with every change after S undone.
+ * readers holds the sequence numbers of the open views; records[start,
+ * end) are the changes after the oldest of them, since the ones before
+ * can't be undone by any view anymore
+ * */
+struct version_log {
+    struct version_record *records;
+    size_t start;
+    size_t end;
+    size_t size;
+    unsigned long long int *readers;
+    size_t readers_count;
+    size_t readers_size;
+};
+
+struct version_log *version_log_new(void);
+
+static inline int version_log_active(struct version_log *log) {
+    return log->readers_count > 0;
+}
+
+void version_log_record(struct version_log *log, unsigned long long int seq, int added,
+                        const char *rel, const char *dest, const char *origin);
+
+const char *version_record_rel(struct version_record *record);
+
+const char *version_record_dest(struct version_record *record);
+
+const char *version_record_origin(struct version_record *record);
+
+void version_log_open(struct version_log *log, unsigned long long int seq);
+
+void version_log_close(struct version_log *log, unsigned long long int seq);
+
+void version_log_destroy(struct version_log *log);
+
+#endif //PROVAFINALEAPI_VERSION_LOG_H